@@ -0,0 +1,490 @@
+// coc_bench.c - micro-benchmarks for the coc.h containers
+// Usage: coc_bench.exe [--rounds=N] [--filter=TEXT] [--json=PATH]
+//                      [--baseline=PATH] [--threshold=PCT]
+// Every case runs one warm-up round and N timed rounds, setup excluded, and
+// reports the median, the minimum and the median absolute deviation in ns per
+// operation. --json writes one case per line, the format --baseline reads back:
+// cases whose median grew by more than the threshold are listed and the exit
+// status is 2.
+#define COC_IMPLEMENTATION
+#include <math.h>
+#include <unistd.h>
+#include "../coc.h"
+
+#define BENCH_ROUNDS    11
+#define BENCH_THRESHOLD 10.0
+#define BENCH_NAME_MAX  64
+
+typedef struct IntVec {
+    int    *items;
+    size_t  size;
+    size_t  capacity;
+} IntVec;
+
+typedef struct BenchEntry {
+    Coc_String key;
+    size_t     value;
+    bool       is_used;
+} BenchEntry;
+
+typedef struct BenchTable {
+    BenchEntry *items;
+    BenchEntry *new_items;
+    uint8_t    *ctrl;
+    size_t      size;
+    size_t      tombstones;
+    size_t      capacity;
+} BenchTable;
+
+typedef struct Keys {
+    Coc_String *items;
+    size_t      size;
+    size_t      capacity;
+} Keys;
+
+typedef struct Result {
+    char   name[BENCH_NAME_MAX];
+    double median;
+    double min;
+    double mad;
+} Result;
+
+typedef struct Results {
+    Result *items;
+    size_t  size;
+    size_t  capacity;
+} Results;
+
+typedef struct Bench {
+    int         rounds;
+    const char *filter;
+    Results     results;
+    double     *samples;
+    double     *devs;
+} Bench;
+
+// One timed round: returns nanoseconds spent on `ops` operations
+typedef uint64_t (*CaseFn)(void *ctx);
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static volatile size_t bench_sink;
+
+static void bench_case(Bench *b, const char *name, size_t ops, CaseFn fn, void *ctx) {
+    if (b->filter != NULL && strstr(name, b->filter) == NULL) return;
+    fn(ctx);
+    for (int r = 0; r < b->rounds; r++) b->samples[r] = (double)fn(ctx) / ops;
+    qsort(b->samples, b->rounds, sizeof(double), cmp_double);
+    Result res = {.median = b->samples[b->rounds / 2], .min = b->samples[0]};
+    for (int r = 0; r < b->rounds; r++) b->devs[r] = fabs(b->samples[r] - res.median);
+    qsort(b->devs, b->rounds, sizeof(double), cmp_double);
+    res.mad = b->devs[b->rounds / 2];
+    snprintf(res.name, sizeof(res.name), "%s", name);
+    printf("  %-34s %10.2f %10.2f %9.2f %6.1f%%\n", res.name, res.median, res.min, res.mad,
+           res.median > 0 ? res.mad / res.median * 100.0 : 0.0);
+    fflush(stdout);
+    coc_vec_append(&b->results, res);
+}
+
+static uint64_t xorshift(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *state = x;
+}
+
+static void keys_free(Keys *keys) {
+    for (size_t i = 0; i < keys->size; i++) coc_str_free(&keys->items[i]);
+    coc_vec_free(keys);
+}
+
+// Key shapes: "L%zu" generated labels, short random identifiers that stay in
+// SSO, and long random names that always live on the heap. `salt` makes a
+// disjoint set of the same shape for misses.
+typedef enum KeyShape { KEYS_LABEL, KEYS_SHORT, KEYS_LONG, KEYS_COUNT } KeyShape;
+static const char *key_shape_names[KEYS_COUNT] = {"label", "short", "long"};
+
+static void keys_build(Keys *keys, KeyShape shape, size_t n, uint64_t salt) {
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ salt;
+    for (size_t i = 0; i < n; i++) {
+        char buf[96];
+        if (shape == KEYS_LABEL) {
+            snprintf(buf, sizeof(buf), "%s%zu", salt ? "M" : "L", i);
+        } else {
+            size_t len = shape == KEYS_SHORT ? 4 + xorshift(&state) % 12 : 32 + xorshift(&state) % 48;
+            for (size_t c = 0; c < len; c++) buf[c] = "abcdefghijklmnopqrstuvwxyz_0123456789"[xorshift(&state) % 37];
+            buf[0] = salt ? 'M' : 'L';
+            // the index keeps every key distinct
+            snprintf(buf + len, sizeof(buf) - len, "%zu", i);
+        }
+        Coc_String key = {0};
+        coc_str_append(&key, buf);
+        coc_vec_append(keys, key);
+    }
+}
+
+// ---------------------------------------------------------------- strings
+
+typedef struct StrCtx {
+    size_t count;   // strings built per round
+    size_t length;  // characters per string
+    size_t chunk;   // characters per append, 1 uses coc_str_push()
+    char   text[4096];
+} StrCtx;
+
+static uint64_t case_str_append(void *ctx) {
+    StrCtx *c = ctx;
+    uint64_t start = coc_now_ns();
+    for (size_t i = 0; i < c->count; i++) {
+        Coc_String s = {0};
+        if (c->chunk == 1) {
+            for (size_t k = 0; k < c->length; k++) coc_str_push(&s, c->text[k & 4095]);
+        } else {
+            for (size_t k = 0; k < c->length; k += c->chunk)
+                coc_str_append_many(&s, c->text, c->length - k < c->chunk ? c->length - k : c->chunk);
+        }
+        bench_sink += coc_str_size(&s);
+        coc_str_free(&s);
+    }
+    return coc_now_ns() - start;
+}
+
+static void bench_strings(Bench *b) {
+    printf("Coc_String append (ns per character, SSO holds %zu):\n", (size_t)COC_SSO_CAP);
+    static StrCtx c;
+    for (size_t i = 0; i < sizeof(c.text); i++) c.text[i] = (char)('a' + i % 26);
+    static const size_t lengths[] = {8, COC_SSO_CAP, 64, 1024, 65536};
+    static const size_t chunks[]  = {1, 8};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(*lengths); l++) {
+        for (size_t k = 0; k < sizeof(chunks) / sizeof(*chunks); k++) {
+            c.length = lengths[l];
+            c.chunk  = chunks[k];
+            c.count  = (4u << 20) / c.length;
+            char name[BENCH_NAME_MAX];
+            snprintf(name, sizeof(name), "str/%s/len=%zu/%s", c.length <= COC_SSO_CAP ? "sso" : "heap",
+                     c.length, c.chunk == 1 ? "push" : "append8");
+            bench_case(b, name, c.count * c.length, case_str_append, &c);
+        }
+    }
+}
+
+// ---------------------------------------------------------------- vectors
+
+typedef struct VecCtx {
+    size_t n;
+    bool   reserve;
+} VecCtx;
+
+static uint64_t case_vec_append(void *ctx) {
+    VecCtx *c = ctx;
+    size_t rounds = (16u << 20) / c->n;
+    uint64_t start = coc_now_ns();
+    for (size_t r = 0; r < rounds; r++) {
+        IntVec v = {0};
+        if (c->reserve) coc_vec_grow(&v, c->n);
+        for (size_t i = 0; i < c->n; i++) coc_vec_append(&v, (int)i);
+        bench_sink += v.items[v.size - 1];
+        coc_vec_free(&v);
+    }
+    return coc_now_ns() - start;
+}
+
+static void bench_vectors(Bench *b) {
+    printf("coc_vec_append (ns per element):\n");
+    static const size_t sizes[] = {16, 1024, 65536, 1u << 20, 16u << 20};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+        for (int reserve = 0; reserve <= 1; reserve++) {
+            VecCtx c = {.n = sizes[s], .reserve = reserve};
+            char name[BENCH_NAME_MAX];
+            snprintf(name, sizeof(name), "vec/n=%zu/%s", c.n, reserve ? "reserved" : "growing");
+            bench_case(b, name, (16u << 20) / c.n * c.n, case_vec_append, &c);
+        }
+    }
+}
+
+// ---------------------------------------------------------------- hash tables
+
+typedef struct HtCtx {
+    Keys       *hit;
+    Keys       *miss;
+    BenchTable  table;
+    size_t      capacity;
+    size_t      n;
+} HtCtx;
+
+static void ht_fill(HtCtx *c, BenchTable *t) {
+    *t = (BenchTable){0};
+    // Size the table up front so that n keys sit at the requested load factor
+    coc_ht_resize(t, (size_t)(c->capacity * COC_HT_LOAD_FACTOR));
+    for (size_t i = 0; i < c->n; i++) coc_ht_insert_copy(t, &c->hit->items[i], i);
+}
+
+static uint64_t case_ht_insert(void *ctx) {
+    HtCtx *c = ctx;
+    BenchTable t = {0};
+    uint64_t start = coc_now_ns();
+    ht_fill(c, &t);
+    uint64_t ns = coc_now_ns() - start;
+    bench_sink += t.size;
+    coc_ht_free(&t);
+    return ns;
+}
+
+static uint64_t ht_find_all(BenchTable *t, Keys *keys, size_t n) {
+    uint64_t start = coc_now_ns();
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t *value;
+        coc_ht_find(t, &keys->items[i], value);
+        found += value != NULL;
+    }
+    bench_sink += found;
+    return coc_now_ns() - start;
+}
+
+static uint64_t case_ht_hit(void *ctx) {
+    HtCtx *c = ctx;
+    return ht_find_all(&c->table, c->hit, c->n);
+}
+
+static uint64_t case_ht_miss(void *ctx) {
+    HtCtx *c = ctx;
+    return ht_find_all(&c->table, c->miss, c->n);
+}
+
+// Lookups use cached key hashes like the VM does, hashing is measured below
+static void bench_tables(Bench *b) {
+    printf("coc_ht insert / find (ns per key, hashes cached):\n");
+    static const size_t capacities[] = {1024, 65536, 1u << 20};
+    static const double loads[]      = {0.25, 0.5, 0.75};
+    for (int shape = 0; shape < KEYS_COUNT; shape++) {
+        Keys hit = {0}, miss = {0};
+        size_t max_cap = capacities[sizeof(capacities) / sizeof(*capacities) - 1];
+        keys_build(&hit, shape, (size_t)(max_cap * COC_HT_LOAD_FACTOR), 0);
+        keys_build(&miss, shape, (size_t)(max_cap * COC_HT_LOAD_FACTOR), 1);
+        for (size_t i = 0; i < hit.size; i++) {
+            coc_hash_value(&hit.items[i]);
+            coc_hash_value(&miss.items[i]);
+        }
+        for (size_t k = 0; k < sizeof(capacities) / sizeof(*capacities); k++) {
+            for (size_t l = 0; l < sizeof(loads) / sizeof(*loads); l++) {
+                HtCtx c = {.hit = &hit, .miss = &miss, .capacity = capacities[k]};
+                c.n = (size_t)(capacities[k] * loads[l]);
+                ht_fill(&c, &c.table);
+                COC_ASSERT(c.table.capacity == c.capacity);
+                Coc_Ht_Stats st;
+                coc_ht_stats(&c.table, &st);
+                size_t reported = b->results.size;
+                static const struct { const char *op; CaseFn fn; } ops[] = {
+                    {"insert", case_ht_insert},
+                    {"hit"   , case_ht_hit   },
+                    {"miss"  , case_ht_miss  },
+                };
+                for (size_t o = 0; o < sizeof(ops) / sizeof(*ops); o++) {
+                    char name[BENCH_NAME_MAX];
+                    snprintf(name, sizeof(name), "ht/%s/cap=%zu/load=%.2f/%s",
+                             key_shape_names[shape], c.capacity, loads[l], ops[o].op);
+                    bench_case(b, name, c.n, ops[o].fn, &c);
+                }
+                if (b->results.size > reported)
+                    printf("  %-34s probe avg %.3f max %zu\n", "", (double)st.probe_total / st.size, st.probe_max);
+                coc_ht_free(&c.table);
+            }
+        }
+        keys_free(&hit);
+        keys_free(&miss);
+    }
+}
+
+// ---------------------------------------------------------------- hashing
+
+typedef struct HashCtx {
+    Coc_String *keys;
+    size_t      count;
+    uint32_t  (*fn)(Coc_String *);
+} HashCtx;
+
+static uint64_t case_hash(void *ctx) {
+    HashCtx *c = ctx;
+    uint32_t acc = 0;
+    uint64_t start = coc_now_ns();
+    for (size_t i = 0; i < c->count; i++) {
+        c->keys[i].is_hash = false;
+        acc ^= c->fn(&c->keys[i]);
+    }
+    bench_sink += acc;
+    return coc_now_ns() - start;
+}
+
+static void bench_hashes(Bench *b) {
+    printf("Hash functions (ns per key):\n");
+    static const struct { const char *name; uint32_t (*fn)(Coc_String *); } fns[] = {
+        {"fnv1a" , coc_hash_fnv1a },
+        {"wyhash", coc_hash_wyhash},
+    };
+    static const size_t lengths[] = {4, 16, 64, 1024, 65536};
+    uint64_t state = 1;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(*lengths); l++) {
+        size_t count = (8u << 20) / lengths[l] < 4096 ? (8u << 20) / lengths[l] : 4096;
+        Coc_String *keys = calloc(count, sizeof(Coc_String));
+        for (size_t i = 0; i < count; i++)
+            for (size_t k = 0; k < lengths[l]; k++) coc_str_push(&keys[i], (char)(' ' + xorshift(&state) % 95));
+        for (size_t f = 0; f < sizeof(fns) / sizeof(*fns); f++) {
+            HashCtx c = {.keys = keys, .count = count, .fn = fns[f].fn};
+            char name[BENCH_NAME_MAX];
+            snprintf(name, sizeof(name), "hash/%s/len=%zu", fns[f].name, lengths[l]);
+            bench_case(b, name, count, case_hash, &c);
+        }
+        for (size_t i = 0; i < count; i++) coc_str_free(&keys[i]);
+        free(keys);
+    }
+}
+
+// ---------------------------------------------------------------- files
+
+typedef struct FileCtx {
+    const char *path;
+} FileCtx;
+
+static uint64_t case_read_file(void *ctx) {
+    FileCtx *c = ctx;
+    Coc_String buf = {0};
+    uint64_t start = coc_now_ns();
+    coc_read_entire_file(c->path, &buf);
+    uint64_t ns = coc_now_ns() - start;
+    bench_sink += coc_str_size(&buf);
+    coc_str_free(&buf);
+    return ns;
+}
+
+static void bench_files(Bench *b) {
+    printf("coc_read_entire_file (ns per KiB, page cache warm):\n");
+    static const size_t sizes[] = {4096, 1u << 20, 16u << 20};
+    char path[] = "/tmp/coc_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        coc_log(COC_ERROR, "mkstemp() failed: %s", strerror(errno));
+        return;
+    }
+    close(fd);
+    char block[4096];
+    memset(block, 'x', sizeof(block));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+        FILE *fp = fopen(path, "wb");
+        for (size_t written = 0; fp != NULL && written < sizes[s]; written += sizeof(block))
+            fwrite(block, 1, sizeof(block), fp);
+        if (fp == NULL || fclose(fp) != 0) {
+            coc_log(COC_ERROR, "Cannot write %s: %s", path, strerror(errno));
+            break;
+        }
+        FileCtx c = {.path = path};
+        char name[BENCH_NAME_MAX];
+        snprintf(name, sizeof(name), "file/size=%zu", sizes[s]);
+        bench_case(b, name, sizes[s] / 1024, case_read_file, &c);
+    }
+    unlink(path);
+}
+
+// ---------------------------------------------------------------- reports
+
+static double json_number(const char *json, const char *key) {
+    char pattern[BENCH_NAME_MAX + 4];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    return p == NULL ? NAN : strtod(p + strlen(pattern), NULL);
+}
+
+static bool write_json(const Results *results, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        coc_log(COC_ERROR, "Cannot write %s: %s", path, strerror(errno));
+        return false;
+    }
+    fprintf(fp, "{\"unit\":\"ns/op\",\"cases\":[\n");
+    for (size_t i = 0; i < results->size; i++) {
+        const Result *r = &results->items[i];
+        fprintf(fp, "  {\"name\":\"%s\",\"median\":%.4f,\"min\":%.4f,\"mad\":%.4f}%s\n",
+                r->name, r->median, r->min, r->mad, i + 1 == results->size ? "" : ",");
+    }
+    fprintf(fp, "]}\n");
+    return fclose(fp) == 0;
+}
+
+// A case regresses when its median grew past the threshold and past three
+// times the spread seen in either run
+static int compare_baseline(const Results *now, const char *path, double threshold) {
+    Coc_String text = {0};
+    if (coc_read_entire_file(path, &text) != 0) return -1;
+    coc_str_append_null(&text);
+    int regressions = 0;
+    for (char *line = strtok(coc_str_data(&text), "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        char *name = strstr(line, "\"name\":\"");
+        if (name == NULL) continue;
+        name += strlen("\"name\":\"");
+        char *end = strchr(name, '"');
+        if (end == NULL) continue;
+        *end = '\0';
+        for (size_t i = 0; i < now->size; i++) {
+            const Result *r = &now->items[i];
+            if (strcmp(r->name, name) != 0) continue;
+            double before = json_number(end + 1, "median"), mad = json_number(end + 1, "mad");
+            double delta = before > 0 ? (r->median - before) / before * 100.0 : 0.0;
+            double noise = 3.0 * (mad > r->mad ? mad : r->mad);
+            if (delta > threshold && r->median - before > noise) {
+                printf("  %-34s %10.2f -> %.2f ns/op (%+.1f%%)\n", r->name, before, r->median, delta);
+                regressions++;
+            }
+        }
+    }
+    coc_str_free(&text);
+    return regressions;
+}
+
+int main(int argc, char *argv[]) {
+    coc_log_init((Coc_Log_Config){.min_level = COC_INFO}, NULL);
+    Bench b = {.rounds = BENCH_ROUNDS};
+    const char *json = NULL, *baseline = NULL;
+    double threshold = BENCH_THRESHOLD;
+    for (int i = 1; i < argc; i++) {
+        const char *value = NULL;
+        size_t len = coc_kv_split(argv[i], &value);
+        if (value != NULL && coc_kv_match(argv[i], len, "--rounds")) b.rounds = atoi(value);
+        else if (value != NULL && coc_kv_match(argv[i], len, "--filter")) b.filter = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--json")) json = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--baseline")) baseline = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--threshold")) threshold = atof(value);
+        else {
+            coc_log(COC_ERROR, "Usage: %s [--rounds=N] [--filter=TEXT] [--json=PATH] "
+                               "[--baseline=PATH] [--threshold=PCT]", argv[0]);
+            return 1;
+        }
+    }
+    if (b.rounds <= 0) b.rounds = BENCH_ROUNDS;
+    b.samples = malloc(b.rounds * sizeof(double));
+    b.devs    = malloc(b.rounds * sizeof(double));
+
+    printf("%d rounds per case after one warm-up round\n", b.rounds);
+    printf("  %-34s %10s %10s %9s %7s\n", "case", "median", "min", "mad", "mad%");
+    bench_strings(&b);
+    bench_vectors(&b);
+    bench_tables(&b);
+    bench_hashes(&b);
+    bench_files(&b);
+
+    int status = 0;
+    if (json != NULL && !write_json(&b.results, json)) status = 1;
+    if (baseline != NULL) {
+        printf("\nRegressions against %s (threshold %.1f%%):\n", baseline, threshold);
+        int regressions = compare_baseline(&b.results, baseline, threshold);
+        if (regressions < 0) status = 1;
+        else if (regressions > 0) status = 2;
+        else printf("  none\n");
+    }
+    free(b.samples);
+    free(b.devs);
+    coc_vec_free(&b.results);
+    coc_log_close();
+    return status;
+}
@@ -0,0 +1,219 @@
+// gen_workloads.c - writes the Puncta programs used by run_bench
+// Usage: gen_workloads.exe [--out=DIR] [--scale=K] [--large]
+//   --scale multiplies every iteration count (default 1)
+//   --large adds the 10^7 instruction straight-line program (~260 MB of source)
+#define COC_IMPLEMENTATION
+#include <sys/stat.h>
+#include "../coc.h"
+
+#define GEN_OUT_DIR "bench/workloads"
+#define GEN_MOD     "1000000007"
+
+typedef struct Gen {
+    const char *dir;
+    long long   scale;
+    FILE       *fp;
+} Gen;
+
+static bool gen_open(Gen *g, const char *name) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.pun", g->dir, name);
+    g->fp = fopen(path, "w");
+    if (g->fp == NULL) {
+        coc_log(COC_ERROR, "Cannot write %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool gen_close(Gen *g, const char *name) {
+    bool ok = !ferror(g->fp);
+    if (fclose(g->fp) != 0) ok = false;
+    g->fp = NULL;
+    if (!ok) coc_log(COC_ERROR, "Cannot write %s: %s", name, strerror(errno));
+    else coc_log(COC_INFO, "Generated %s", name);
+    return ok;
+}
+
+#define gen(g, ...) fprintf((g)->fp, __VA_ARGS__)
+
+// eval! sees single-letter variables and single-digit literals only, string
+// operands hold at most STRING_LEN characters, and the target is overwritten
+// by the expression before evaluation: constants live in their own variables
+// and results go through the temporary t.
+
+// examples/fib.pun without input, modulo a prime so that it never overflows
+static void gen_fib(Gen *g) {
+    gen(g, "(fib: %lld terms modulo " GEN_MOD ")\n", 1000000 * g->scale);
+    gen(g, "n, %lld. M, " GEN_MOD ". a, 0. b, 1. res, 0.\n", 1000000 * g->scale);
+    gen(g, "loop:\n"
+           "    res, eval! @\"(a+b)%%M\".\n"
+           "    a, b.\n"
+           "    b, res.\n"
+           "    n, dec!\n"
+           "    n, 0? End;\n"
+           "loop;\n"
+           "End:\n"
+           "res, print!\n");
+}
+
+// examples/gcd.pun over many pseudo-random pairs
+static void gen_gcd(Gen *g) {
+    gen(g, "(gcd: Euclid on %lld pairs)\n", 100000 * g->scale);
+    gen(g, "i, %lld. G, 7919. H, 7907. P, 1000003. Q, 999983. S, 0.\n", 100000 * g->scale);
+    gen(g, "next:\n"
+           "    A, eval! @\"i*G%%P+1\".\n"
+           "    B, eval! @\"i*H%%Q+1\".\n"
+           "gcd_loop:\n"
+           "    B, 0? gcdRet;\n"
+           "    R, eval! @\"A%%B\".\n"
+           "    A, B.\n"
+           "    B, R.\n"
+           "gcd_loop;\n"
+           "gcdRet:\n"
+           "    t, eval! @\"S+A\".\n"
+           "    S, t.\n"
+           "    i, dec!\n"
+           "    i, 0? End;\n"
+           "next;\n"
+           "End:\n"
+           "S, print!\n");
+}
+
+// examples/exgcd.pun over many pseudo-random pairs
+static void gen_exgcd(Gen *g) {
+    gen(g, "(exgcd: extended Euclid on %lld pairs)\n", 50000 * g->scale);
+    gen(g, "i, %lld. G, 7919. H, 7907. P, 1000003. Q, 999983. M, " GEN_MOD ". S, 0.\n", 50000 * g->scale);
+    gen(g, "next:\n"
+           "    R, eval! @\"i*G%%P+1\".\n"
+           "    r, eval! @\"i*H%%Q+1\".\n"
+           "    X, 1. Y, 0. x, 0. y, 1.\n"
+           "exgcd_loop:\n"
+           "    r, 0? exgcdRet;\n"
+           "    q, eval! @\"R/r\".\n"
+           "    q, toint!\n"
+           "    r1, eval! @\"R%%r\".\n"
+           "    x1, eval! @\"X-q*x\".\n"
+           "    y1, eval! @\"Y-q*y\".\n"
+           "    R, r. r, r1.\n"
+           "    X, x. x, x1.\n"
+           "    Y, y. y, y1.\n"
+           "exgcd_loop;\n"
+           "exgcdRet:\n"
+           "    t, eval! @\"(S+X*X)%%M\".\n"
+           "    S, eval! @\"(t+Y*Y)%%M\".\n"
+           "    i, dec!\n"
+           "    i, 0? End;\n"
+           "next;\n"
+           "End:\n"
+           "S, print!\n");
+}
+
+// Several expressions per iteration, dominated by eval's parser and evaluator
+static void gen_eval(Gen *g) {
+    gen(g, "(eval: %lld iterations of two linear congruential generators)\n", 200000 * g->scale);
+    gen(g, "n, %lld. J, 69069. K, 12345. U, 1664525. W, 4294967296. V, 16777216. Q, 1000.\n",
+        200000 * g->scale);
+    gen(g, "x, 1. y, 2. z, 0.\n"
+           "loop:\n"
+           "    t, eval! @\"(x*J+K)%%W\".\n"
+           "    x, t.\n"
+           "    t, eval! @\"(y*U+x)%%V\".\n"
+           "    y, t.\n"
+           "    z, eval! @\"(x%%Q+y%%Q)/2\".\n"
+           "    n, dec!\n"
+           "    n, 0? End;\n"
+           "loop;\n"
+           "End:\n"
+           "z, print!\n");
+}
+
+// Number formatting and stdout, run_bench sends stdout to /dev/null
+static void gen_print(Gen *g) {
+    gen(g, "(print: %lld lines of output)\n", 500000 * g->scale);
+    gen(g, "n, %lld. s, \" \". nl, 10.\n", 500000 * g->scale);
+    gen(g, "loop:\n"
+           "    n, putn!\n"
+           "    s, putc!\n"
+           "    n, putx!\n"
+           "    nl, putc!\n"
+           "    n, dec!\n"
+           "    n, 0? End;\n"
+           "loop;\n"
+           "End:\n"
+           "s, puts! @\"done\\n\".\n");
+}
+
+// 1000 labels jumping into each other, the chain walked repeatedly
+static void gen_jumps(Gen *g) {
+    const int depth = 1000;
+    gen(g, "(jumps: a chain of %d labels walked %lld times)\n", depth, 20000 * g->scale);
+    gen(g, "n, %lld.\n", 20000 * g->scale);
+    gen(g, "start:\nL0;\n");
+    for (int i = depth - 1; i >= 1; i--) gen(g, "L%d: L%d;\n", i, i + 1);
+    gen(g, "L0: L1;\n");
+    gen(g, "L%d:\n"
+           "    n, dec!\n"
+           "    n, 0? End;\n"
+           "start;\n"
+           "End:\n"
+           "n, print!\n", depth);
+}
+
+// Straight-line code, one label per instruction: compile-time bound
+static void gen_big(Gen *g, long long count) {
+    gen(g, "(big: %lld instructions and labels)\n", count);
+    for (long long i = 0; i < count; i++) {
+        gen(g, "L%lld: v%lld, %lld.\n", i, i % 1000, i);
+        if (i % 16 == 15) gen(g, "v%lld, 0? L%lld;\n", i % 1000, i - 15);
+    }
+    gen(g, "v0, print!\n");
+}
+
+int main(int argc, char *argv[]) {
+    coc_log_init((Coc_Log_Config){.min_level = COC_INFO}, NULL);
+    Gen g = {.dir = GEN_OUT_DIR, .scale = 1};
+    bool large = false;
+    for (int i = 1; i < argc; i++) {
+        const char *value = NULL;
+        size_t len = coc_kv_split(argv[i], &value);
+        if (coc_kv_match(argv[i], len, "--out") && value != NULL) g.dir = value;
+        else if (coc_kv_match(argv[i], len, "--scale") && value != NULL) g.scale = atoll(value);
+        else if (coc_kv_match(argv[i], len, "--large")) large = true;
+        else {
+            coc_log(COC_ERROR, "Usage: %s [--out=DIR] [--scale=K] [--large]", argv[0]);
+            return 1;
+        }
+    }
+    if (g.scale <= 0) g.scale = 1;
+    if (mkdir(g.dir, 0755) != 0 && errno != EEXIST) {
+        coc_log(COC_ERROR, "Cannot create %s: %s", g.dir, strerror(errno));
+        return 1;
+    }
+    static const struct { const char *name; void (*fn)(Gen *); } workloads[] = {
+        {"fib"  , gen_fib  },
+        {"gcd"  , gen_gcd  },
+        {"exgcd", gen_exgcd},
+        {"eval" , gen_eval },
+        {"print", gen_print},
+        {"jumps", gen_jumps},
+    };
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(*workloads); i++) {
+        if (!gen_open(&g, workloads[i].name)) return 1;
+        workloads[i].fn(&g);
+        if (!gen_close(&g, workloads[i].name)) return 1;
+    }
+    static const struct { const char *name; long long count; bool large; } bigs[] = {
+        {"big_1e5", 100000  , false},
+        {"big_1e6", 1000000 , false},
+        {"big_1e7", 10000000, true },
+    };
+    for (size_t i = 0; i < sizeof(bigs) / sizeof(*bigs); i++) {
+        if (bigs[i].large && !large) continue;
+        if (!gen_open(&g, bigs[i].name)) return 1;
+        gen_big(&g, bigs[i].count);
+        if (!gen_close(&g, bigs[i].name)) return 1;
+    }
+    coc_log_close();
+    return 0;
+}
@@ -0,0 +1,200 @@
+// hash_bench.c - compares coc_hash_fnv1a() and coc_hash_wyhash()
+// Usage: hash_bench.exe [rounds]
+#define COC_IMPLEMENTATION
+#include <math.h>
+#include "../coc.h"
+
+#define HASH_BENCH_ROUNDS 15
+#define HASH_BENCH_BYTES  (64u * 1024 * 1024)
+
+typedef uint32_t (*HashFn)(Coc_String *);
+
+typedef struct KeySet {
+    const char *name;
+    Coc_String *items;
+    size_t      size;
+    size_t      capacity;
+} KeySet;
+
+static double now_sec(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void keyset_add(KeySet *set, const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    Coc_String key = {0};
+    coc_str_append(&key, buf);
+    coc_vec_append(set, key);
+}
+
+static void keyset_free(KeySet *set) {
+    for (size_t i = 0; i < set->size; i++) coc_str_free(&set->items[i]);
+    coc_vec_free(set);
+}
+
+// Identifier shapes that occur in Puncta programs and generated code
+static void keyset_build(KeySet *sets) {
+    sets[0].name = "single-letter vars";
+    for (int c = 'A'; c <= 'z'; c++) if (isalpha(c)) keyset_add(&sets[0], "%c", c);
+    for (int c = 'a'; c <= 'z'; c++)
+        for (int d = 0; d < 10; d++) keyset_add(&sets[0], "%c%d", c, d);
+
+    sets[1].name = "short names";
+    static const char *words[] = {"loop", "res", "gcd", "exgcd", "tmp", "cnt", "idx", "n", "sum", "acc"};
+    static const char *sufs[]  = {"", "Ret", "End", "_loop", "_a", "_b", "_next", "_tmp"};
+    for (size_t w = 0; w < sizeof(words) / sizeof(*words); w++)
+        for (size_t s = 0; s < sizeof(sufs) / sizeof(*sufs); s++)
+            for (int i = 0; i < 50; i++) keyset_add(&sets[1], "%s%s%d", words[w], sufs[s], i);
+
+    sets[2].name = "generated labels";
+    for (int i = 0; i < 100000; i++) keyset_add(&sets[2], "L%d", i);
+
+    sets[3].name = "long generated names";
+    for (int i = 0; i < 50000; i++) keyset_add(&sets[3], "module_%03d_function_%05d_block_%d", i % 97, i, i % 7);
+}
+
+// Keys expected beyond the first COC_HT_GROUP slots of their group for a
+// uniform hash: groups * sum over k > GROUP of (k - GROUP) * Binomial(n, 1/groups)(k)
+static double expected_overflow(size_t n, size_t groups) {
+    double p = 1.0 / (double)groups, sum = 0.0;
+    for (size_t k = COC_HT_GROUP + 1; k <= n; k++) {
+        double log_pmf = lgamma((double)n + 1) - lgamma((double)k + 1) - lgamma((double)(n - k) + 1) +
+                         (double)k * log(p) + (double)(n - k) * log1p(-p);
+        double term = (double)(k - COC_HT_GROUP) * exp(log_pmf);
+        sum += term;
+        if (term < 1e-12 && (double)k > (double)n * p) break;
+    }
+    return sum * (double)groups;
+}
+
+// Mirrors the Swiss table layout: the home group comes from hash >> 7 and
+// the low 7 bits are h2, the control byte a group scan compares first.
+//   overflow  keys that do not fit in their home group and must probe on
+//   h2 pairs  keys sharing both home group and h2, i.e. control byte
+//             matches that need a full key compare
+static void report_quality(const char *hash_name, HashFn fn, KeySet *set) {
+    size_t cap = COC_HT_INIT_CAP;
+    while (set->size > cap * COC_HT_LOAD_FACTOR) cap *= 2;
+    size_t groups = cap / COC_HT_GROUP;
+    uint32_t *hashes = malloc(set->size * sizeof(uint32_t));
+    uint32_t *loads = calloc(groups, sizeof(uint32_t));
+    uint32_t *h2s = calloc(groups * 128, sizeof(uint32_t));
+    for (size_t i = 0; i < set->size; i++) {
+        set->items[i].is_hash = false;
+        hashes[i] = fn(&set->items[i]);
+        size_t g = (hashes[i] >> 7) & (groups - 1);
+        loads[g]++;
+        h2s[g * 128 + coc_ht_h2(hashes[i])]++;
+    }
+    size_t full = 0, overflow = 0, max_load = 0, h2_pairs = 0;
+    for (size_t g = 0; g < groups; g++) {
+        if (loads[g] > COC_HT_GROUP) overflow += loads[g] - COC_HT_GROUP;
+        if (loads[g] > max_load) max_load = loads[g];
+    }
+    for (size_t i = 0; i < groups * 128; i++) h2_pairs += (size_t)h2s[i] * (h2s[i] - (h2s[i] > 0)) / 2;
+    // Full 32-bit collisions: sort and count equal neighbours
+    qsort(hashes, set->size, sizeof(uint32_t), cmp_u32);
+    for (size_t i = 1; i < set->size; i++) full += hashes[i] == hashes[i - 1];
+    double n = (double)set->size;
+    double expect_pairs = n * (n - 1) / 2.0 / ((double)groups * 128.0);
+    printf("  %-8s %-22s keys=%-7zu groups=%-6zu full=%-4zu overflow=%-6zu (uniform %.1f) max=%-3zu h2 pairs=%-6zu (uniform %.0f)\n",
+           hash_name, set->name, set->size, groups, full, overflow, expected_overflow(set->size, groups),
+           max_load, h2_pairs, expect_pairs);
+    free(hashes);
+    free(loads);
+    free(h2s);
+}
+
+static double bench_keys(HashFn fn, KeySet *set, int rounds) {
+    double *samples = malloc(rounds * sizeof(double));
+    volatile uint32_t sink = 0;
+    for (int r = 0; r < rounds; r++) {
+        double start = now_sec();
+        for (int rep = 0; rep < 20; rep++) {
+            for (size_t i = 0; i < set->size; i++) {
+                set->items[i].is_hash = false;
+                sink ^= fn(&set->items[i]);
+            }
+        }
+        samples[r] = (now_sec() - start) * 1e9 / (20.0 * set->size);
+    }
+    qsort(samples, rounds, sizeof(double), cmp_double);
+    double median = samples[rounds / 2];
+    free(samples);
+    COC_UNUSED(sink);
+    return median;
+}
+
+static double bench_bulk(HashFn fn, Coc_String *buf, int rounds) {
+    double *samples = malloc(rounds * sizeof(double));
+    volatile uint32_t sink = 0;
+    for (int r = 0; r < rounds; r++) {
+        buf->is_hash = false;
+        double start = now_sec();
+        sink ^= fn(buf);
+        samples[r] = coc_str_size(buf) / (now_sec() - start) / 1e9;
+    }
+    qsort(samples, rounds, sizeof(double), cmp_double);
+    double median = samples[rounds / 2];
+    free(samples);
+    COC_UNUSED(sink);
+    return median;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : HASH_BENCH_ROUNDS;
+    if (rounds <= 0) rounds = HASH_BENCH_ROUNDS;
+    static const struct { const char *name; HashFn fn; } hashes[] = {
+        {"fnv1a" , coc_hash_fnv1a },
+        {"wyhash", coc_hash_wyhash},
+    };
+    const size_t hash_count = sizeof(hashes) / sizeof(*hashes);
+    KeySet sets[4] = {0};
+    keyset_build(sets);
+    const size_t set_count = sizeof(sets) / sizeof(*sets);
+
+    printf("Collisions (full 32-bit; group overflow and same-group h2 pairs at load factor %.2f, %d-slot groups):\n",
+           COC_HT_LOAD_FACTOR, COC_HT_GROUP);
+    for (size_t s = 0; s < set_count; s++)
+        for (size_t h = 0; h < hash_count; h++) report_quality(hashes[h].name, hashes[h].fn, &sets[s]);
+
+    printf("\nThroughput on key sets (median of %d rounds, ns/key):\n", rounds);
+    for (size_t s = 0; s < set_count; s++) {
+        printf("  %-22s", sets[s].name);
+        for (size_t h = 0; h < hash_count; h++)
+            printf("  %s %6.2f", hashes[h].name, bench_keys(hashes[h].fn, &sets[s], rounds));
+        printf("\n");
+    }
+
+    Coc_String bulk = {0};
+    coc_str_reserve(&bulk, HASH_BENCH_BYTES);
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i < HASH_BENCH_BYTES; i++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        coc_str_push(&bulk, (char)(' ' + x % 95));
+    }
+    printf("\nBulk throughput on %u MiB (median of %d rounds, GB/s):\n ", HASH_BENCH_BYTES >> 20, rounds);
+    for (size_t h = 0; h < hash_count; h++)
+        printf("  %s %6.2f", hashes[h].name, bench_bulk(hashes[h].fn, &bulk, rounds));
+    printf("\n");
+
+    coc_str_free(&bulk);
+    for (size_t s = 0; s < set_count; s++) keyset_free(&sets[s]);
+    return 0;
+}
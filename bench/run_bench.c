@@ -0,0 +1,292 @@
+// run_bench.c - runs puncta.exe over the generated workloads and reports JSON
+// Usage: run_bench.exe [--puncta=EXE] [--dir=DIR] [--runs=N] [--out=PATH]
+//                      [--baseline=PATH] [--threshold=PCT]
+// Every workload runs N times with --stats-json, stdin from /dev/null and stdout
+// to /dev/null. The medians of compile time, run time, instructions per second
+// and peak RSS are written one workload per line, so an older report can be
+// passed back as --baseline: the deltas are printed and the exit status is 2
+// when compile or run time grew by more than the threshold.
+#define COC_IMPLEMENTATION
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../coc.h"
+
+#define BENCH_RUNS      5
+#define BENCH_THRESHOLD 5.0
+#define BENCH_NAME_MAX  64
+#define BENCH_NOISE_MS  1.0 // phases shorter than this never count as regressions
+
+typedef struct Sample {
+    double compile_ms;
+    double run_ms;
+    double ips;
+    double instructions;
+    double rss_kb;
+} Sample;
+
+typedef struct Result {
+    char   name[BENCH_NAME_MAX];
+    Sample median;
+} Result;
+
+typedef struct Results {
+    Result *items;
+    size_t  size;
+    size_t  capacity;
+} Results;
+
+typedef struct Names {
+    char  **items;
+    size_t  size;
+    size_t  capacity;
+} Names;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Value of "key": in a flat JSON text, or NAN when it is missing
+static double json_number(const char *json, const char *key) {
+    char pattern[BENCH_NAME_MAX + 4];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *p = strstr(json, pattern);
+    return p == NULL ? NAN : strtod(p + strlen(pattern), NULL);
+}
+
+static char *read_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return NULL;
+    Coc_String text = {0};
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        for (size_t i = 0; i < n; i++) coc_str_push(&text, buf[i]);
+    fclose(fp);
+    char *copy = strdup(coc_str_size(&text) ? coc_str_data(&text) : "");
+    coc_str_free(&text);
+    return copy;
+}
+
+static bool run_once(const char *puncta, const char *program, const char *stats, Sample *out) {
+    char stats_arg[1024];
+    snprintf(stats_arg, sizeof(stats_arg), "--stats-json=%s", stats);
+    pid_t pid = fork();
+    if (pid < 0) {
+        coc_log(COC_ERROR, "fork() failed: %s", strerror(errno));
+        return false;
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_RDWR);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+        }
+        execl(puncta, puncta, "--log-level=ERROR", stats_arg, program, (char *)NULL);
+        _exit(127);
+    }
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        coc_log(COC_ERROR, "wait4() failed: %s", strerror(errno));
+        return false;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        coc_log(COC_ERROR, "%s %s exited with status %d", puncta, program, status);
+        return false;
+    }
+    char *json = read_file(stats);
+    if (json == NULL) {
+        coc_log(COC_ERROR, "Cannot read %s: %s", stats, strerror(errno));
+        return false;
+    }
+    out->compile_ms   = json_number(json, "read") + json_number(json, "lex")
+                      + json_number(json, "parse") + json_number(json, "link")
+                      + json_number(json, "load");
+    out->run_ms       = json_number(json, "run");
+    out->instructions = json_number(json, "instructions");
+    out->ips          = json_number(json, "instructions_per_sec");
+    out->rss_kb       = (double)usage.ru_maxrss;
+    free(json);
+    return true;
+}
+
+static bool bench_workload(const char *puncta, const char *program, const char *stats, int runs, Sample *median) {
+    double *columns[5];
+    for (int c = 0; c < 5; c++) columns[c] = malloc(runs * sizeof(double));
+    bool ok = true;
+    for (int r = 0; r < runs && ok; r++) {
+        Sample s = {0};
+        ok = run_once(puncta, program, stats, &s);
+        columns[0][r] = s.compile_ms;
+        columns[1][r] = s.run_ms;
+        columns[2][r] = s.ips;
+        columns[3][r] = s.instructions;
+        columns[4][r] = s.rss_kb;
+    }
+    double med[5] = {0};
+    for (int c = 0; c < 5 && ok; c++) {
+        qsort(columns[c], runs, sizeof(double), cmp_double);
+        med[c] = columns[c][runs / 2];
+    }
+    for (int c = 0; c < 5; c++) free(columns[c]);
+    *median = (Sample){med[0], med[1], med[2], med[3], med[4]};
+    return ok;
+}
+
+static void write_result(FILE *fp, const Result *r, bool last) {
+    fprintf(fp, "  {\"name\":\"%s\",\"compile_ms\":%.3f,\"run_ms\":%.3f,\"instructions\":%.0f,"
+                "\"instructions_per_sec\":%.0f,\"peak_rss_kb\":%.0f}%s\n",
+            r->name, r->median.compile_ms, r->median.run_ms, r->median.instructions,
+            r->median.ips, r->median.rss_kb, last ? "" : ",");
+}
+
+// Reads the one-workload-per-line report written by write_result()
+static bool load_baseline(const char *path, Results *base) {
+    char *text = read_file(path);
+    if (text == NULL) {
+        coc_log(COC_ERROR, "Cannot read baseline %s: %s", path, strerror(errno));
+        return false;
+    }
+    for (char *line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+        char *name = strstr(line, "\"name\":\"");
+        if (name == NULL) continue;
+        name += strlen("\"name\":\"");
+        char *end = strchr(name, '"');
+        if (end == NULL || end - name >= BENCH_NAME_MAX) continue;
+        Result r = {0};
+        memcpy(r.name, name, end - name);
+        r.median.compile_ms   = json_number(line, "compile_ms");
+        r.median.run_ms       = json_number(line, "run_ms");
+        r.median.instructions = json_number(line, "instructions");
+        r.median.ips          = json_number(line, "instructions_per_sec");
+        r.median.rss_kb       = json_number(line, "peak_rss_kb");
+        coc_vec_append(base, r);
+    }
+    free(text);
+    return true;
+}
+
+static double delta_pct(double now, double before) {
+    return before > 0 ? (now - before) / before * 100.0 : 0.0;
+}
+
+static int compare_baseline(const Results *now, const Results *base, double threshold) {
+    int regressions = 0;
+    fprintf(stderr, "%-10s %12s %12s %12s %12s\n", "workload", "compile", "run", "ips", "rss");
+    for (size_t i = 0; i < now->size; i++) {
+        const Result *r = &now->items[i], *b = NULL;
+        for (size_t j = 0; j < base->size && b == NULL; j++)
+            if (strcmp(base->items[j].name, r->name) == 0) b = &base->items[j];
+        if (b == NULL) {
+            fprintf(stderr, "%-10s %12s\n", r->name, "(new)");
+            continue;
+        }
+        double compile = delta_pct(r->median.compile_ms, b->median.compile_ms);
+        double run     = delta_pct(r->median.run_ms, b->median.run_ms);
+        bool slower = (compile > threshold && r->median.compile_ms > BENCH_NOISE_MS)
+                   || (run > threshold && r->median.run_ms > BENCH_NOISE_MS);
+        fprintf(stderr, "%-10s %+11.1f%% %+11.1f%% %+11.1f%% %+11.1f%%%s\n", r->name, compile, run,
+                delta_pct(r->median.ips, b->median.ips), delta_pct(r->median.rss_kb, b->median.rss_kb),
+                slower ? "  REGRESSION" : "");
+        regressions += slower;
+    }
+    return regressions;
+}
+
+int main(int argc, char *argv[]) {
+    coc_log_init((Coc_Log_Config){.min_level = COC_INFO}, NULL);
+    const char *puncta = "./puncta.exe", *dir = "bench/workloads";
+    const char *out_path = NULL, *baseline = NULL;
+    int runs = BENCH_RUNS;
+    double threshold = BENCH_THRESHOLD;
+    for (int i = 1; i < argc; i++) {
+        const char *value = NULL;
+        size_t len = coc_kv_split(argv[i], &value);
+        if (value != NULL && coc_kv_match(argv[i], len, "--puncta")) puncta = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--dir")) dir = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--runs")) runs = atoi(value);
+        else if (value != NULL && coc_kv_match(argv[i], len, "--out")) out_path = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--baseline")) baseline = value;
+        else if (value != NULL && coc_kv_match(argv[i], len, "--threshold")) threshold = atof(value);
+        else {
+            coc_log(COC_ERROR, "Usage: %s [--puncta=EXE] [--dir=DIR] [--runs=N] [--out=PATH] "
+                               "[--baseline=PATH] [--threshold=PCT]", argv[0]);
+            return 1;
+        }
+    }
+    if (runs <= 0) runs = BENCH_RUNS;
+
+    Names programs = {0};
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        coc_log(COC_ERROR, "Cannot open %s: %s (run gen_workloads first)", dir, strerror(errno));
+        return 1;
+    }
+    for (struct dirent *e; (e = readdir(d)) != NULL;) {
+        size_t n = strlen(e->d_name);
+        if (n > 4 && n - 4 < BENCH_NAME_MAX && strcmp(e->d_name + n - 4, ".pun") == 0)
+            coc_vec_append(&programs, strdup(e->d_name));
+    }
+    closedir(d);
+    qsort(programs.items, programs.size, sizeof(char *), cmp_name);
+
+    char stats[] = "/tmp/puncta_bench_XXXXXX";
+    int stats_fd = mkstemp(stats);
+    if (stats_fd < 0) {
+        coc_log(COC_ERROR, "mkstemp() failed: %s", strerror(errno));
+        return 1;
+    }
+    close(stats_fd);
+
+    Results results = {0};
+    int status = 0;
+    for (size_t i = 0; i < programs.size; i++) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, programs.items[i]);
+        Result r = {0};
+        memcpy(r.name, programs.items[i], strlen(programs.items[i]) - 4);
+        coc_log(COC_INFO, "Running %s (%d runs)", r.name, runs);
+        if (!bench_workload(puncta, path, stats, runs, &r.median)) {
+            status = 1;
+            continue;
+        }
+        coc_vec_append(&results, r);
+    }
+    unlink(stats);
+
+    FILE *out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+        coc_log(COC_ERROR, "Cannot write %s: %s", out_path, strerror(errno));
+        return 1;
+    }
+    fprintf(out, "{\"puncta\":\"%s\",\"runs\":%d,\"workloads\":[\n", puncta, runs);
+    for (size_t i = 0; i < results.size; i++) write_result(out, &results.items[i], i + 1 == results.size);
+    fprintf(out, "]}\n");
+    if (out != stdout) fclose(out);
+
+    if (baseline != NULL) {
+        Results base = {0};
+        if (!load_baseline(baseline, &base)) return 1;
+        int regressions = compare_baseline(&results, &base, threshold);
+        if (regressions > 0) {
+            coc_log(COC_ERROR, "%d workload(s) slower than %s by more than %.1f%%", regressions, baseline, threshold);
+            status = 2;
+        }
+        coc_vec_free(&base);
+    }
+
+    for (size_t i = 0; i < programs.size; i++) free(programs.items[i]);
+    coc_vec_free(&programs);
+    coc_vec_free(&results);
+    coc_log_close();
+    return status;
+}
@@ -1,21 +1,20 @@
-// coc.h - version 1.4.1 (2026-01-16)
+// coc.h - version 1.16.2 (2026-10-18)
 #ifndef COC_H_
 #define COC_H_
 
 #define COC_VERSION_MAJOR 1
-#define COC_VERSION_MINOR 4
-#define COC_VERSION_PATCH 1
+#define COC_VERSION_MINOR 16
+#define COC_VERSION_PATCH 2
 
 #ifndef COCDEF
    #define COCDEF static inline
 #endif // COCDEF
 
 #ifndef COC_MALLOC
-   #include <stdlib.h>
-   #define COC_MALLOC(...)  malloc(__VA_ARGS__)
-   #define COC_REALLOC(...) realloc(__VA_ARGS__)
-   #define COC_CALLOC(...)  calloc(__VA_ARGS__)
-   #define COC_FREE(...)    free(__VA_ARGS__)
+   #define COC_MALLOC(...)  coc_malloc(__VA_ARGS__)
+   #define COC_REALLOC(...) coc_realloc(__VA_ARGS__)
+   #define COC_CALLOC(...)  coc_calloc(__VA_ARGS__)
+   #define COC_FREE(...)    coc_free(__VA_ARGS__)
 #endif // COC_MALLOC
 
 #ifndef COC_ASSERT
@@ -31,6 +30,7 @@
 #endif // _WIN32
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <stdint.h>
@@ -38,6 +38,385 @@
 #include <ctype.h>
 #include <stdarg.h>
 
+#ifndef COC_NO_THREADS
+   #include <pthread.h>
+   #include <signal.h>
+   #include <stdatomic.h>
+#endif // COC_NO_THREADS
+
+#ifndef COC_THREAD_LOCAL
+   #ifdef _MSC_VER
+      #define COC_THREAD_LOCAL __declspec(thread)
+   #else
+      #define COC_THREAD_LOCAL _Thread_local
+   #endif // _MSC_VER
+#endif // COC_THREAD_LOCAL
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+   #include <emmintrin.h>
+   #define COC_HT_SSE2
+#endif // __SSE2__
+
+#if defined(__x86_64__) || defined(__i386__)
+   #include <x86intrin.h>
+   #define COC_HAS_RDTSC
+#elif defined(_M_X64) || defined(_M_IX86)
+   #include <intrin.h>
+   #define COC_HAS_RDTSC
+#endif // __x86_64__
+
+#if defined(__GLIBC__) || defined(__linux__)
+   #include <malloc.h>
+   #define coc_alloc_size(ptr) malloc_usable_size(ptr)
+#elif defined(__APPLE__)
+   #include <malloc/malloc.h>
+   #define coc_alloc_size(ptr) malloc_size(ptr)
+#elif defined(_WIN32)
+   #include <malloc.h>
+   #define coc_alloc_size(ptr) _msize(ptr)
+#endif // __GLIBC__
+
+#ifndef _WIN32
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+#endif // _WIN32
+
+// Arena format:
+// typedef struct Arena {
+//     Block  *head;     (newest block first)
+//     Large  *large;    (allocations of COC_ARENA_LARGE bytes or more)
+//     size_t  used;     (bytes handed out)
+//     size_t  reserved; (bytes held in blocks and large allocations)
+// } Arena;
+//
+// While an arena is active (coc_arena_begin), the default COC_MALLOC,
+// COC_REALLOC and COC_CALLOC hooks bump-allocate from it and COC_FREE on
+// a small allocation it owns is a no-op. Everything is released by
+// coc_arena_free().
+//
+// Large allocations (growing vectors, hash table arrays) are malloc'ed one
+// by one instead, so that growing or freeing them really returns the old
+// memory rather than leaving a dead copy in a block.
+
+#define COC_ARENA_BLOCK_CAP  (64 * 1024)
+#define COC_ARENA_LARGE      (COC_ARENA_BLOCK_CAP / 8)
+#define COC_ARENA_ALIGN      16
+
+typedef struct Coc_Arena_Block {
+    struct Coc_Arena_Block *next;
+    size_t                  size;
+    size_t                  capacity;
+    size_t                  last;
+} Coc_Arena_Block;
+
+typedef struct Coc_Arena_Large {
+    struct Coc_Arena_Large *next;
+    struct Coc_Arena_Large *prev;
+    size_t                  size;
+} Coc_Arena_Large;
+
+typedef struct Coc_Arena {
+    Coc_Arena_Block *head;
+    Coc_Arena_Large *large;
+    size_t           used;
+    size_t           reserved;
+} Coc_Arena;
+
+// Each thread has its own active arena, so compiling on one thread never
+// allocates from an arena that another thread has begun.
+extern COC_THREAD_LOCAL Coc_Arena *coc_global_arena;
+
+// Heap accounting for the default COC_MALLOC hooks, off until enabled.
+// Sizes come from the allocator (coc_alloc_size), so nothing is added to
+// the allocations themselves; arena blocks are counted by their capacity.
+// The counters are atomic unless COC_NO_THREADS is defined; enable the
+// accounting before starting threads.
+#ifndef COC_NO_THREADS
+   #define COC_HEAP_COUNTER _Atomic size_t
+#else
+   #define COC_HEAP_COUNTER size_t
+#endif // COC_NO_THREADS
+
+typedef struct Coc_Heap_Stats {
+    bool             enabled;
+    COC_HEAP_COUNTER current;
+    COC_HEAP_COUNTER peak;
+    COC_HEAP_COUNTER allocs;
+    COC_HEAP_COUNTER frees;
+} Coc_Heap_Stats;
+
+extern Coc_Heap_Stats coc_global_heap;
+
+COCDEF bool coc_heap_stats_available() {
+#ifdef coc_alloc_size
+    return true;
+#else
+    return false;
+#endif // coc_alloc_size
+}
+
+COCDEF void coc_heap_add(size_t n) {
+#ifndef COC_NO_THREADS
+    Coc_Heap_Stats *h = &coc_global_heap;
+    atomic_fetch_add_explicit(&h->allocs, 1, memory_order_relaxed);
+    size_t cur  = atomic_fetch_add_explicit(&h->current, n, memory_order_relaxed) + n;
+    size_t peak = atomic_load_explicit(&h->peak, memory_order_relaxed);
+    while (cur > peak && !atomic_compare_exchange_weak_explicit(&h->peak, &peak, cur,
+                                                                memory_order_relaxed, memory_order_relaxed));
+#else
+    coc_global_heap.allocs++;
+    coc_global_heap.current += n;
+    if (coc_global_heap.current > coc_global_heap.peak)
+        coc_global_heap.peak = coc_global_heap.current;
+#endif // COC_NO_THREADS
+}
+
+COCDEF void coc_heap_sub(size_t n) {
+#ifndef COC_NO_THREADS
+    Coc_Heap_Stats *h = &coc_global_heap;
+    atomic_fetch_add_explicit(&h->frees, 1, memory_order_relaxed);
+    // Blocks allocated before accounting was enabled
+    size_t cur = atomic_load_explicit(&h->current, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&h->current, &cur, n < cur ? cur - n : 0,
+                                                  memory_order_relaxed, memory_order_relaxed));
+#else
+    coc_global_heap.frees++;
+    // Blocks allocated before accounting was enabled
+    coc_global_heap.current = n < coc_global_heap.current ? coc_global_heap.current - n : 0;
+#endif // COC_NO_THREADS
+}
+
+COCDEF size_t coc_heap_size(void *ptr) {
+#ifdef coc_alloc_size
+    return ptr != NULL ? coc_alloc_size(ptr) : 0;
+#else
+    (void)ptr;
+    return 0;
+#endif // coc_alloc_size
+}
+
+COCDEF char *coc_arena_block_data(Coc_Arena_Block *blk) {
+    return (char *)(blk + 1);
+}
+
+COCDEF size_t coc_arena_align(size_t n) {
+    return (n + COC_ARENA_ALIGN - 1) & ~(size_t)(COC_ARENA_ALIGN - 1);
+}
+
+COCDEF char *coc_arena_large_data(Coc_Arena_Large *l) {
+    return (char *)l + coc_arena_align(sizeof(Coc_Arena_Large));
+}
+
+COCDEF void *coc_arena_alloc_large(Coc_Arena *a, size_t n) {
+    size_t total = coc_arena_align(sizeof(Coc_Arena_Large)) + n;
+    Coc_Arena_Large *l = malloc(total);
+    COC_ASSERT(l != NULL && "Malloc failed");
+    if (coc_global_heap.enabled) coc_heap_add(total);
+    l->next = a->large;
+    l->prev = NULL;
+    l->size = n;
+    if (a->large != NULL) a->large->prev = l;
+    a->large     = l;
+    a->used     += n;
+    a->reserved += n;
+    return coc_arena_large_data(l);
+}
+
+COCDEF Coc_Arena_Large *coc_arena_large_of(Coc_Arena *a, const void *ptr) {
+    for (Coc_Arena_Large *l = a->large; l != NULL; l = l->next) {
+        if (coc_arena_large_data(l) == (const char *)ptr) return l;
+    }
+    return NULL;
+}
+
+// Every allocation is preceded by a COC_ARENA_ALIGN sized header holding
+// its size, so that coc_arena_realloc() knows how much to copy.
+COCDEF void *coc_arena_alloc(Coc_Arena *a, size_t n) {
+    COC_ASSERT(a != NULL);
+    if (n >= COC_ARENA_LARGE) return coc_arena_alloc_large(a, n);
+    size_t need = COC_ARENA_ALIGN + coc_arena_align(n);
+    Coc_Arena_Block *blk = a->head;
+    if (blk == NULL || blk->size + need > blk->capacity) {
+        size_t cap = blk == NULL ? COC_ARENA_BLOCK_CAP : blk->capacity * 2;
+        while (cap < need) cap *= 2;
+        blk = malloc(sizeof(Coc_Arena_Block) + cap);
+        COC_ASSERT(blk != NULL && "Malloc failed");
+        if (coc_global_heap.enabled) coc_heap_add(sizeof(Coc_Arena_Block) + cap);
+        blk->next     = a->head;
+        blk->size     = 0;
+        blk->capacity = cap;
+        blk->last     = 0;
+        a->head       = blk;
+        a->reserved  += cap;
+    }
+    char *hdr = coc_arena_block_data(blk) + blk->size;
+    *(size_t *)hdr = n;
+    blk->last  = blk->size;
+    blk->size += need;
+    a->used   += n;
+    return hdr + COC_ARENA_ALIGN;
+}
+
+COCDEF bool coc_arena_owns(Coc_Arena *a, const void *ptr) {
+    COC_ASSERT(a != NULL);
+    const char *p = (const char *)ptr;
+    for (Coc_Arena_Block *blk = a->head; blk != NULL; blk = blk->next) {
+        char *data = coc_arena_block_data(blk);
+        if (p >= data && p < data + blk->size) return true;
+    }
+    return coc_arena_large_of(a, ptr) != NULL;
+}
+
+// Frees ptr if it is a large allocation of a; returns whether a owns ptr.
+COCDEF bool coc_arena_release(Coc_Arena *a, void *ptr) {
+    COC_ASSERT(a != NULL);
+    Coc_Arena_Large *l = coc_arena_large_of(a, ptr);
+    if (l == NULL) return coc_arena_owns(a, ptr);
+    if (l->prev != NULL) l->prev->next = l->next;
+    else                 a->large      = l->next;
+    if (l->next != NULL) l->next->prev = l->prev;
+    a->used     -= l->size;
+    a->reserved -= l->size;
+    if (coc_global_heap.enabled) coc_heap_sub(coc_arena_align(sizeof(Coc_Arena_Large)) + l->size);
+    free(l);
+    return true;
+}
+
+// Large allocations go through realloc(); of the bump allocations only the
+// most recent one grows in place, and only while it stays small.
+COCDEF void *coc_arena_realloc(Coc_Arena *a, void *ptr, size_t n) {
+    COC_ASSERT(a != NULL);
+    if (ptr == NULL) return coc_arena_alloc(a, n);
+    Coc_Arena_Large *l = coc_arena_large_of(a, ptr);
+    if (l != NULL) {
+        size_t head = coc_arena_align(sizeof(Coc_Arena_Large));
+        size_t old  = l->size;
+        Coc_Arena_Large *res = realloc(l, head + n);
+        COC_ASSERT(res != NULL && "Realloc failed");
+        if (coc_global_heap.enabled) {
+            coc_heap_sub(head + old);
+            coc_heap_add(head + n);
+        }
+        if (res->prev != NULL) res->prev->next = res;
+        else                   a->large        = res;
+        if (res->next != NULL) res->next->prev = res;
+        res->size   = n;
+        a->used     = a->used - old + n;
+        a->reserved = a->reserved - old + n;
+        return coc_arena_large_data(res);
+    }
+    char *hdr = (char *)ptr - COC_ARENA_ALIGN;
+    size_t old = *(size_t *)hdr;
+    Coc_Arena_Block *blk = a->head;
+    if (n < COC_ARENA_LARGE && hdr == coc_arena_block_data(blk) + blk->last) {
+        size_t need = COC_ARENA_ALIGN + coc_arena_align(n);
+        if (blk->last + need <= blk->capacity) {
+            blk->size = blk->last + need;
+            *(size_t *)hdr = n;
+            a->used = a->used - old + n;
+            return ptr;
+        }
+    }
+    void *res = coc_arena_alloc(a, n);
+    memcpy(res, ptr, old < n ? old : n);
+    return res;
+}
+
+COCDEF void coc_arena_free(Coc_Arena *a) {
+    COC_ASSERT(a != NULL);
+    Coc_Arena_Block *blk = a->head;
+    while (blk != NULL) {
+        Coc_Arena_Block *next = blk->next;
+        if (coc_global_heap.enabled) coc_heap_sub(sizeof(Coc_Arena_Block) + blk->capacity);
+        free(blk);
+        blk = next;
+    }
+    Coc_Arena_Large *l = a->large;
+    while (l != NULL) {
+        Coc_Arena_Large *next = l->next;
+        if (coc_global_heap.enabled) coc_heap_sub(coc_arena_align(sizeof(Coc_Arena_Large)) + l->size);
+        free(l);
+        l = next;
+    }
+    *a = (Coc_Arena){0};
+}
+
+// Hands every block and large allocation of src to dst, which frees them
+// with its own; src is left empty. The latest allocation of dst still
+// grows in place.
+COCDEF void coc_arena_merge(Coc_Arena *dst, Coc_Arena *src) {
+    COC_ASSERT(dst != NULL && src != NULL);
+    if (src->head != NULL) {
+        if (dst->head == NULL) {
+            dst->head = src->head;
+        } else {
+            Coc_Arena_Block *tail = src->head;
+            while (tail->next != NULL) tail = tail->next;
+            tail->next      = dst->head->next;
+            dst->head->next = src->head;
+        }
+    }
+    if (src->large != NULL) {
+        Coc_Arena_Large *tail = src->large;
+        while (tail->next != NULL) tail = tail->next;
+        tail->next = dst->large;
+        if (dst->large != NULL) dst->large->prev = tail;
+        dst->large = src->large;
+    }
+    dst->used     += src->used;
+    dst->reserved += src->reserved;
+    *src = (Coc_Arena){0};
+}
+
+COCDEF Coc_Arena *coc_arena_begin(Coc_Arena *a) {
+    Coc_Arena *prev = coc_global_arena;
+    coc_global_arena = a;
+    return prev;
+}
+
+COCDEF void coc_arena_end(Coc_Arena *prev) {
+    coc_global_arena = prev;
+}
+
+COCDEF void *coc_malloc(size_t n) {
+    if (coc_global_arena) return coc_arena_alloc(coc_global_arena, n);
+    void *ptr = malloc(n);
+    if (coc_global_heap.enabled && ptr) coc_heap_add(coc_heap_size(ptr));
+    return ptr;
+}
+
+COCDEF void *coc_calloc(size_t count, size_t n) {
+    if (coc_global_arena) {
+        void *ptr = coc_arena_alloc(coc_global_arena, count * n);
+        memset(ptr, 0, count * n);
+        return ptr;
+    }
+    void *ptr = calloc(count, n);
+    if (coc_global_heap.enabled && ptr) coc_heap_add(coc_heap_size(ptr));
+    return ptr;
+}
+
+COCDEF void *coc_realloc(void *ptr, size_t n) {
+    if (coc_global_arena && (ptr == NULL || coc_arena_owns(coc_global_arena, ptr)))
+        return coc_arena_realloc(coc_global_arena, ptr, n);
+    if (!coc_global_heap.enabled) return realloc(ptr, n);
+    size_t old_size = coc_heap_size(ptr);
+    void *new_ptr = realloc(ptr, n);
+    if (new_ptr != NULL) {
+        if (ptr != NULL) coc_heap_sub(old_size);
+        coc_heap_add(coc_heap_size(new_ptr));
+    }
+    return new_ptr;
+}
+
+COCDEF void coc_free(void *ptr) {
+    if (coc_global_arena && coc_arena_release(coc_global_arena, ptr)) return;
+    if (coc_global_heap.enabled && ptr) coc_heap_sub(coc_heap_size(ptr));
+    free(ptr);
+}
+
 typedef enum Coc_Log_Level {
     COC_DEBUG,
     COC_INFO,
@@ -53,11 +432,28 @@ typedef struct Coc_Log_Config {
     bool          use_time;
     bool          use_ms;
     bool          use_color;
+    bool          use_async;
     FILE         *out;
 } Coc_Log_Config;
 
 extern Coc_Log_Config coc_global_log_config;
 
+// A thread can log through its own config (an embedded interpreter per
+// thread, each with its own level and file); NULL means the global one.
+// Only the global config can be asynchronous.
+extern COC_THREAD_LOCAL Coc_Log_Config *coc_thread_log_config;
+
+COCDEF Coc_Log_Config *coc_log_current() {
+    return coc_thread_log_config != NULL ? coc_thread_log_config : &coc_global_log_config;
+}
+
+// Returns the previous override, to be restored by the caller
+COCDEF Coc_Log_Config *coc_log_use(Coc_Log_Config *config) {
+    Coc_Log_Config *prev = coc_thread_log_config;
+    coc_thread_log_config = config;
+    return prev;
+}
+
 #define COC_LOG_MIN_LEVEL    COC_INFO
 #define COC_LOG_OUT          stderr
 #define COC_LOG_RESET        "\033[0m"
@@ -65,11 +461,47 @@ extern Coc_Log_Config coc_global_log_config;
 #define COC_LOG_GREEN        "\033[32m"
 #define COC_LOG_YELLOW       "\033[33m"
 #define COC_LOG_CYAN         "\033[36m"
+#define COC_LOG_LINE_MAX     1024
+#define COC_LOG_RING_CAP     (64 * 1024)
+#define COC_LOG_DRAIN_MS     10
+
+// Calls below this level are removed at compile time,
+// e.g. -DCOC_LOG_COMPILED_MIN_LEVEL=COC_INFO for release builds
+#ifndef COC_LOG_COMPILED_MIN_LEVEL
+   #define COC_LOG_COMPILED_MIN_LEVEL COC_DEBUG
+#endif // COC_LOG_COMPILED_MIN_LEVEL
+
+// COC_COLD keeps rarely used code out of the inlining budget of hot paths
+#if defined(__GNUC__) || defined(__clang__)
+   #define COC_FORCE_INLINE static inline __attribute__((always_inline))
+   #define COC_COLD         __attribute__((cold))
+   #define COC_LIKELY(x)    __builtin_expect(!!(x), 1)
+   #define COC_UNLIKELY(x)  __builtin_expect(!!(x), 0)
+#elif defined(_MSC_VER)
+   #define COC_FORCE_INLINE static __forceinline
+   #define COC_COLD
+   #define COC_LIKELY(x)    (x)
+   #define COC_UNLIKELY(x)  (x)
+#else
+   #define COC_FORCE_INLINE static inline
+   #define COC_COLD
+   #define COC_LIKELY(x)    (x)
+   #define COC_UNLIKELY(x)  (x)
+#endif // __GNUC__
+
+#if defined(__GNUC__) || defined(__clang__)
+   #define COC_LOG_PRINTF(fmt_idx, arg_idx) __attribute__((format(printf, fmt_idx, arg_idx)))
+#else
+   #define COC_LOG_PRINTF(fmt_idx, arg_idx)
+#endif // __GNUC__
 
 #define COC_VEC_INIT_CAP     64
 
 #define COC_HT_INIT_CAP      16
 #define COC_HT_LOAD_FACTOR   0.75f
+#define COC_HT_GROUP         16
+#define COC_HT_EMPTY         0x80
+#define COC_HT_DELETED       0xFE
 
 #ifndef COC_UNUSED
    #define COC_UNUSED(x) (void)(x)
@@ -77,31 +509,299 @@ extern Coc_Log_Config coc_global_log_config;
 
 #define coc_defer(value) do { result = (value); goto defer; } while (0)
 
-COCDEF void coc_log_time() {
+// Date and time strings only change once per second, so each thread keeps
+// the last formatted second and only appends the milliseconds.
+typedef struct Coc_Log_Clock {
+    time_t sec;
+    bool   valid;
+    char   date[16];
+    char   time[16];
+} Coc_Log_Clock;
+
+static COC_THREAD_LOCAL Coc_Log_Clock coc_log_clock;
+
+COCDEF size_t coc_log_format_time(char *buf, size_t size) {
     struct timespec now;
     timespec_get(&now, TIME_UTC);
-    struct tm tm_info;
-    localtime_r(&now.tv_sec, &tm_info);
-    char buf_date[32] = "";
-    char buf_time[32] = "";
+    if (!coc_log_clock.valid || coc_log_clock.sec != now.tv_sec) {
+        struct tm tm_info;
+        localtime_r(&now.tv_sec, &tm_info);
+        strftime(coc_log_clock.date, sizeof(coc_log_clock.date), " %Y-%m-%d", &tm_info);
+        strftime(coc_log_clock.time, sizeof(coc_log_clock.time), " %H:%M:%S", &tm_info);
+        coc_log_clock.sec   = now.tv_sec;
+        coc_log_clock.valid = true;
+    }
+    const Coc_Log_Config *config = coc_log_current();
     char buf_ms[32] = "";
-    if (coc_global_log_config.use_date) {
-	strftime(buf_date, sizeof(buf_date), " %Y-%m-%d", &tm_info);
+    if (config->use_time && config->use_ms)
+        snprintf(buf_ms, sizeof(buf_ms), ".%03ld", now.tv_nsec / 1000000);
+    int n = snprintf(buf, size, "[%s%s%s ] ",
+                     config->use_date ? coc_log_clock.date : "",
+                     config->use_time ? coc_log_clock.time : "",
+                     buf_ms);
+    if (n < 0) return 0;
+    return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+COCDEF void coc_log_time() {
+    char buf[64];
+    size_t len = coc_log_format_time(buf, sizeof(buf));
+    FILE *out = coc_log_current()->out;
+    fwrite(buf, 1, len, out ? out : COC_LOG_OUT);
+}
+
+// Async mode: every thread formats complete lines into its own ring
+// (single producer, single consumer, no locks on the logging path) and a
+// background thread drains all rings to coc_global_log_config.out.
+// Records are a uint16_t length followed by the line bytes.
+//
+// A ring lives as long as its thread, across async stop and start. When
+// the thread exits, a pthread key destructor clears owned and the consumer
+// frees the ring once it has been drained.
+#ifndef COC_NO_THREADS
+
+typedef struct Coc_Log_Ring {
+    struct Coc_Log_Ring *next;
+    atomic_bool          owned;
+    _Atomic size_t       head;
+    _Atomic size_t       tail;
+    char                 data[COC_LOG_RING_CAP];
+} Coc_Log_Ring;
+
+typedef struct Coc_Log_Async {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;   // drain thread: lines are waiting
+    pthread_cond_t  space;  // producers: a ring was drained
+    pthread_t       thread;
+    Coc_Log_Ring   *rings;
+    atomic_bool     running;
+    bool            atexit_set;
+    pthread_once_t  key_once;
+    pthread_key_t   key;
+    bool            has_key;
+} Coc_Log_Async;
+
+extern Coc_Log_Async coc_global_log_async;
+
+static COC_THREAD_LOCAL Coc_Log_Ring *coc_log_thread_ring;
+
+COCDEF void coc_log_ring_copy(char *dst, const char *src, size_t n, size_t pos, bool to_ring) {
+    size_t off = pos & (COC_LOG_RING_CAP - 1);
+    size_t first = COC_LOG_RING_CAP - off;
+    if (first > n) first = n;
+    if (to_ring) {
+        memcpy(dst + off, src, first);
+        memcpy(dst, src + first, n - first);
+    } else {
+        memcpy(dst, src + off, first);
+        memcpy(dst + first, src, n - first);
+    }
+}
+
+// Thread exit: hand the ring over to the consumer
+COCDEF void coc_log_ring_release(void *ring) {
+    coc_log_thread_ring = NULL;
+    atomic_store_explicit(&((Coc_Log_Ring *)ring)->owned, false, memory_order_release);
+    pthread_cond_signal(&coc_global_log_async.wake);
+}
+
+COCDEF void coc_log_key_init() {
+    Coc_Log_Async *async = &coc_global_log_async;
+    async->has_key = pthread_key_create(&async->key, coc_log_ring_release) == 0;
+}
+
+COCDEF Coc_Log_Ring *coc_log_ring_get() {
+    Coc_Log_Async *async = &coc_global_log_async;
+    Coc_Log_Ring *ring = coc_log_thread_ring;
+    if (ring != NULL) return ring;
+    pthread_once(&async->key_once, coc_log_key_init);
+    // Rings are never handed to the arena allocator
+    ring = calloc(1, sizeof(Coc_Log_Ring));
+    if (ring == NULL) return NULL;
+    atomic_init(&ring->owned, true);
+    // Without the key the ring is never released, it stays with the list
+    if (async->has_key) pthread_setspecific(async->key, ring);
+    pthread_mutex_lock(&async->lock);
+    ring->next   = async->rings;
+    async->rings = ring;
+    pthread_mutex_unlock(&async->lock);
+    coc_log_thread_ring = ring;
+    return ring;
+}
+
+// Caller holds coc_global_log_async.lock. Rings whose thread has exited
+// are freed once they are empty.
+COCDEF void coc_log_drain_locked() {
+    FILE *out = coc_global_log_config.out;
+    bool written = false;
+    Coc_Log_Ring **link = &coc_global_log_async.rings;
+    while (*link != NULL) {
+        Coc_Log_Ring *ring = *link;
+        // Read before head: the last push of the owner is then visible
+        bool orphan = !atomic_load_explicit(&ring->owned, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head) {
+            char line[COC_LOG_LINE_MAX];
+            uint16_t len;
+            coc_log_ring_copy((char *)&len, ring->data, sizeof(len), tail, false);
+            coc_log_ring_copy(line, ring->data, len, tail + sizeof(len), false);
+            fwrite(line, 1, len, out);
+            tail += sizeof(len) + len;
+            written = true;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        if (orphan) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    if (written) {
+        fflush(out);
+        pthread_cond_broadcast(&coc_global_log_async.space);
+    }
+}
+
+COCDEF void coc_log_flush() {
+    Coc_Log_Config *config = coc_thread_log_config;
+    if (config != NULL && config != &coc_global_log_config) {
+        if (config->out) fflush(config->out);
+        return;
+    }
+    if (!atomic_load(&coc_global_log_async.running)) {
+        if (coc_global_log_config.out) fflush(coc_global_log_config.out);
+        return;
+    }
+    pthread_mutex_lock(&coc_global_log_async.lock);
+    coc_log_drain_locked();
+    pthread_mutex_unlock(&coc_global_log_async.lock);
+}
+
+COCDEF void *coc_log_async_main(void *arg) {
+    COC_UNUSED(arg);
+    Coc_Log_Async *async = &coc_global_log_async;
+    pthread_mutex_lock(&async->lock);
+    while (atomic_load(&async->running)) {
+        coc_log_drain_locked();
+        struct timespec deadline;
+        timespec_get(&deadline, TIME_UTC);
+        deadline.tv_nsec += COC_LOG_DRAIN_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&async->wake, &async->lock, &deadline);
+    }
+    coc_log_drain_locked();
+    pthread_mutex_unlock(&async->lock);
+    return NULL;
+}
+
+// Returns false when the line could not be queued (no ring), so the
+// caller falls back to a synchronous write.
+COCDEF bool coc_log_ring_full(Coc_Log_Ring *ring, size_t head, size_t need) {
+    return COC_LOG_RING_CAP - (head - atomic_load_explicit(&ring->tail, memory_order_acquire)) < need;
+}
+
+COCDEF bool coc_log_enqueue(const char *line, size_t len, int level) {
+    Coc_Log_Async *async = &coc_global_log_async;
+    Coc_Log_Ring *ring = coc_log_ring_get();
+    if (ring == NULL) return false;
+    size_t need = sizeof(uint16_t) + len;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    while (coc_log_ring_full(ring, head, need)) {
+        // Full: never drop a line, wait for the drain thread instead, or
+        // drain here if it has been stopped meanwhile
+        pthread_mutex_lock(&async->lock);
+        if (!atomic_load(&async->running)) {
+            coc_log_drain_locked();
+        } else if (coc_log_ring_full(ring, head, need)) {
+            pthread_cond_signal(&async->wake);
+            pthread_cond_wait(&async->space, &async->lock);
+        }
+        pthread_mutex_unlock(&async->lock);
+    }
+    uint16_t len16 = (uint16_t)len;
+    coc_log_ring_copy(ring->data, (const char *)&len16, sizeof(len16), head, true);
+    coc_log_ring_copy(ring->data, line, len, head + sizeof(len16), true);
+    atomic_store_explicit(&ring->head, head + need, memory_order_release);
+    // Pairs with the running store in coc_log_async_stop(): either its final
+    // drain sees this line or we see the stop and drain it ourselves
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load(&async->running)) {
+        pthread_mutex_lock(&async->lock);
+        coc_log_drain_locked();
+        pthread_mutex_unlock(&async->lock);
+        return true;
+    }
+    size_t used = head + need - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (level >= COC_WARNING || used > COC_LOG_RING_CAP / 2)
+        pthread_cond_signal(&async->wake);
+    return true;
+}
+
+COCDEF void coc_log_async_stop() {
+    Coc_Log_Async *async = &coc_global_log_async;
+    if (!atomic_load(&async->running)) return;
+    pthread_mutex_lock(&async->lock);
+    atomic_store(&async->running, false);
+    pthread_cond_signal(&async->wake);
+    pthread_mutex_unlock(&async->lock);
+    pthread_join(async->thread, NULL);
+    // Rings of live threads stay in the list for the next start; producers
+    // waiting for space drain by themselves now
+    pthread_mutex_lock(&async->lock);
+    pthread_cond_broadcast(&async->space);
+    pthread_mutex_unlock(&async->lock);
+}
+
+// exit() is the usual way out after an error, make sure nothing is lost
+COCDEF void coc_log_async_atexit() {
+    coc_log_async_stop();
+}
+
+COCDEF bool coc_log_async_start() {
+    Coc_Log_Async *async = &coc_global_log_async;
+    if (atomic_load(&async->running)) return true;
+    atomic_store(&async->running, true);
+    // The drain thread inherits a fully blocked mask, so process-directed
+    // signals (SIGPROF, SIGUSR1, ...) always land on the other threads
+    sigset_t all, prev;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &prev);
+    int err = pthread_create(&async->thread, NULL, coc_log_async_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &prev, NULL);
+    if (err != 0) {
+        atomic_store(&async->running, false);
+        return false;
     }
-    if (coc_global_log_config.use_time) {
-	strftime(buf_time, sizeof(buf_time), " %H:%M:%S", &tm_info);
-	if (coc_global_log_config.use_ms)
-	    snprintf(buf_ms, sizeof(buf_ms), ".%03ld", now.tv_nsec / 1000000);
+    if (!async->atexit_set) {
+        atexit(coc_log_async_atexit);
+        async->atexit_set = true;
     }
-    fprintf(coc_global_log_config.out, "[%s%s%s ] ", buf_date, buf_time, buf_ms);
+    return true;
 }
 
+#else
+
+COCDEF void coc_log_flush() {
+    FILE *out = coc_log_current()->out;
+    if (out) fflush(out);
+}
+
+#endif // COC_NO_THREADS
+
 COCDEF void coc_log_core(int level, const char *fmt, va_list args) {
     COC_ASSERT(level >= COC_DEBUG && level <= COC_NONE);
-    if ((int)coc_global_log_config.min_level > level) return;
-    if (coc_global_log_config.use_time ||
-	coc_global_log_config.use_date )
-	coc_log_time();
+    const Coc_Log_Config *config = coc_log_current();
+    if ((int)config->min_level > level) return;
+    char line[COC_LOG_LINE_MAX];
+    size_t len = 0;
+    if (config->use_time ||
+	config->use_date )
+	len = coc_log_format_time(line, sizeof(line));
     const char *tag = "";
     const char *color = "";
     switch (level) {
@@ -112,24 +812,69 @@ COCDEF void coc_log_core(int level, const char *fmt, va_list args) {
     case COC_FATAL  : tag = "FATAL"  ; color = COC_LOG_RED   ; break;
     default: break;
     }
-    if (coc_global_log_config.use_color && coc_global_log_config.out == COC_LOG_OUT)
-        fprintf(COC_LOG_OUT, "[%s%s" COC_LOG_RESET "] ", color, tag);
+    FILE *out = config->out ? config->out : COC_LOG_OUT;
+    if (config->use_color && out == COC_LOG_OUT)
+        len += snprintf(line + len, sizeof(line) - len, "[%s%s" COC_LOG_RESET "] ", color, tag);
     else
-        fprintf(coc_global_log_config.out, "[%s] ", tag);
-    vfprintf(coc_global_log_config.out, fmt, args);
-    fprintf(coc_global_log_config.out, "\n");
-    if (level >= COC_WARNING) fflush(coc_global_log_config.out);
+        len += snprintf(line + len, sizeof(line) - len, "[%s] ", tag);
+    va_list copy;
+    va_copy(copy, args);
+    int n = vsnprintf(line + len, sizeof(line) - len - 1, fmt, args);
+    bool fits = n >= 0 && len + (size_t)n < sizeof(line) - 1;
+    if (fits) {
+        len += (size_t)n;
+        line[len++] = '\n';
+    }
+#ifndef COC_NO_THREADS
+    if (config == &coc_global_log_config && config->use_async &&
+        atomic_load(&coc_global_log_async.running)) {
+        if (!fits) {
+            // Over-long lines are cut in async mode
+            len = sizeof(line) - 4;
+            memcpy(line + len, "..\n", 3);
+            len += 3;
+        }
+        if (coc_log_enqueue(line, len, level)) {
+            if (level >= COC_ERROR) coc_log_flush();
+            va_end(copy);
+            return;
+        }
+    }
+#endif // COC_NO_THREADS
+    if (fits) {
+        fwrite(line, 1, len, out);
+    } else {
+        fwrite(line, 1, len, out);
+        vfprintf(out, fmt, copy);
+        fputc('\n', out);
+    }
+    va_end(copy);
+    if (level >= COC_WARNING) fflush(out);
 }
 
-COCDEF void coc_log(Coc_Log_Level level, const char *fmt, ...) {
+COCDEF void coc_log_fmt(int level, const char *fmt, ...) COC_LOG_PRINTF(2, 3);
+COCDEF void coc_log_fmt(int level, const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    coc_log_core((int)level, fmt, args);
+    coc_log_core(level, fmt, args);
     va_end(args);
 }
 
-#define coc_log_raw(level, ...) do {           \
-    if (level < (int)COC_LOG_MIN_LEVEL) break; \
+// Cheap runtime check, use it to guard work that only feeds a log call
+#define coc_log_enabled(level)                           \
+    ((int)(level) >= (int)COC_LOG_COMPILED_MIN_LEVEL &&  \
+     (int)(level) >= (int)coc_log_current()->min_level)
+
+// Levels below COC_LOG_COMPILED_MIN_LEVEL compile to nothing: the
+// condition is a constant, so the arguments are never evaluated
+#define coc_log(level, ...) do {                           \
+    if (!coc_log_enabled(level)) break;                    \
+    coc_log_fmt((int)(level), __VA_ARGS__);                \
+} while (0)
+
+#define coc_log_raw(level, ...) do {                     \
+    if ((int)(level) < (int)COC_LOG_COMPILED_MIN_LEVEL ||  \
+        (int)(level) < (int)COC_LOG_MIN_LEVEL) break;      \
     fprintf(COC_LOG_OUT, __VA_ARGS__);         \
     fprintf(COC_LOG_OUT, "\n");                \
 } while (0)
@@ -144,23 +889,48 @@ COCDEF void coc_log_init(Coc_Log_Config config, const char *filename) {
             exit(errno);
         }
         coc_global_log_config.out = fp;
-    } 
+    }
+#ifndef COC_NO_THREADS
+    if (config.use_async && !coc_log_async_start()) {
+        coc_global_log_config.use_async = false;
+        coc_log(COC_WARNING, "cannot start log thread, falling back to synchronous logging");
+    }
+#else
+    coc_global_log_config.use_async = false;
+#endif // COC_NO_THREADS
 }
 
 COCDEF void coc_log_close() {
+#ifndef COC_NO_THREADS
+    coc_log_async_stop();
+#endif // COC_NO_THREADS
+    coc_global_log_config.use_async = false;
     FILE *out = coc_global_log_config.out;
     if (out && out != COC_LOG_OUT) fclose(out);
+    else if (out) fflush(out);
     coc_global_log_config.out = COC_LOG_OUT;
 }
 
 COCDEF void coc_log_reopen(const char *filename) {
     COC_ASSERT(filename != NULL);
-    coc_log_close();
     FILE *fp = fopen(filename, "a+");
     if (fp == NULL) {
         coc_log(COC_FATAL, "cannot write file %s: %s", filename, strerror(errno));
         exit(errno);
     }
+#ifndef COC_NO_THREADS
+    // Keep the drain thread, swap the file under its lock
+    if (atomic_load(&coc_global_log_async.running)) {
+        pthread_mutex_lock(&coc_global_log_async.lock);
+        coc_log_drain_locked();
+        FILE *old = coc_global_log_config.out;
+        if (old && old != COC_LOG_OUT) fclose(old);
+        coc_global_log_config.out = fp;
+        pthread_mutex_unlock(&coc_global_log_async.lock);
+        return;
+    }
+#endif // COC_NO_THREADS
+    coc_log_close();
     coc_global_log_config.out = fp;
 }
 
@@ -425,6 +1195,95 @@ defer:
     return result;
 }
 
+// Read-only view of a whole file: mmap() where available, otherwise the
+// file is read into a heap buffer. Returns 0 or errno and logs nothing,
+// so that callers can treat a missing file as a normal condition.
+typedef struct Coc_File_Map {
+    char   *data;
+    size_t  size;
+    bool    is_mapped;
+} Coc_File_Map;
+
+COCDEF int coc_map_file(const char *path, Coc_File_Map *map) {
+    COC_ASSERT(path != NULL);
+    COC_ASSERT(map != NULL);
+    *map = (Coc_File_Map){0};
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    map->size = (size_t)st.st_size;
+    if (map->size > 0) {
+        void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            *map = (Coc_File_Map){0};
+            return err;
+        }
+        map->data      = data;
+        map->is_mapped = true;
+    }
+    close(fd);
+    return 0;
+#else
+    int result = 0;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) return errno;
+    if (fseek(fp, 0, SEEK_END) < 0) coc_defer(errno);
+    long file_size = ftell(fp);
+    if (file_size < 0) coc_defer(errno);
+    if (fseek(fp, 0, SEEK_SET) < 0) coc_defer(errno);
+    map->size = (size_t)file_size;
+    map->data = malloc(map->size + 1);
+    if (map->data == NULL) coc_defer(ENOMEM);
+    if (fread(map->data, 1, map->size, fp) != map->size) coc_defer(EIO);
+defer:
+    if (result != 0) {
+        free(map->data);
+        *map = (Coc_File_Map){0};
+    }
+    fclose(fp);
+    return result;
+#endif // _WIN32
+}
+
+COCDEF void coc_unmap_file(Coc_File_Map *map) {
+    COC_ASSERT(map != NULL);
+#ifndef _WIN32
+    if (map->is_mapped) munmap(map->data, map->size);
+    else free(map->data);
+#else
+    free(map->data);
+#endif // _WIN32
+    *map = (Coc_File_Map){0};
+}
+
+COCDEF uint64_t coc_now_ns() {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif // CLOCK_MONOTONIC
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Time stamp counter where available (not serializing, fine for totals
+// over many calls), nanoseconds otherwise
+COCDEF uint64_t coc_cycles() {
+#ifdef COC_HAS_RDTSC
+    return __rdtsc();
+#else
+    return coc_now_ns();
+#endif // COC_HAS_RDTSC
+}
+
 // typedef struct Entry {
 //     Coc_String key;
 //     long long  value;
@@ -432,12 +1291,20 @@ defer:
 // } Entry;
 
 // typedef struct HashTable {
-//     Entry  *items;
-//     Entry  *new_items;
-//     size_t  size;
-//     size_t  capacity;
+//     Entry   *items;
+//     Entry   *new_items;
+//     uint8_t *ctrl;
+//     size_t   size;
+//     size_t   tombstones;
+//     size_t   capacity;
 // } HashTable;
 
+// Swiss-table layout: ctrl[i] is COC_HT_EMPTY, COC_HT_DELETED (tombstone)
+// or the low 7 bits of the key hash (h2). Slots are probed a group of
+// COC_HT_GROUP control bytes at a time; the group sequence is triangular
+// over (hash >> 7), which visits every group since the group count is a
+// power of two. Stored key hashes are compared before the keys themselves.
+
 COCDEF uint32_t coc_hash_fnv1a(Coc_String *key) {
     COC_ASSERT((key) != NULL);
     if (key->is_hash) return key->hash;
@@ -453,51 +1320,260 @@ COCDEF uint32_t coc_hash_fnv1a(Coc_String *key) {
     return hash;
 }
 
-#define coc_hash_value coc_hash_fnv1a
+COCDEF uint64_t coc_read_u64(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+COCDEF uint64_t coc_read_u32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64x64 -> 128 bit multiply, low half xor high half
+COCDEF uint64_t coc_wymix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif // __SIZEOF_INT128__
+}
+
+// wyhash-style: 16 bytes per round, short keys read as two overlapping
+// 4-byte (or 1..3 byte) loads, the tail as the last 16 bytes of the key.
+// Never reads outside [data, data + size).
+COCDEF uint32_t coc_hash_wyhash(Coc_String *key) {
+    COC_ASSERT((key) != NULL);
+    if (key->is_hash) return key->hash;
+    const uint64_t s0 = 0xa0761d6478bd642full;
+    const uint64_t s1 = 0xe7037ed1a0b428dbull;
+    const uint64_t s2 = 0x8ebc6af09c88c6e3ull;
+    const char *p = coc_str_data(key);
+    size_t size = coc_str_size(key);
+    uint64_t seed = s0, a = 0, b = 0;
+    if (size <= 16) {
+        if (size >= 4) {
+            size_t mid = (size >> 3) << 2;
+            a = (coc_read_u32(p) << 32) | coc_read_u32(p + mid);
+            b = (coc_read_u32(p + size - 4) << 32) | coc_read_u32(p + size - 4 - mid);
+        } else if (size > 0) {
+            a = ((uint64_t)(unsigned char)p[0] << 16) |
+                ((uint64_t)(unsigned char)p[size >> 1] << 8) |
+                (uint64_t)(unsigned char)p[size - 1];
+        }
+    } else {
+        size_t i = size;
+        while (i > 16) {
+            seed = coc_wymix(coc_read_u64(p) ^ s1, coc_read_u64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = coc_read_u64(p + i - 16);
+        b = coc_read_u64(p + i - 8);
+    }
+    uint64_t h = coc_wymix(s1 ^ size, coc_wymix(a ^ s1, b ^ seed ^ s2));
+    key->hash    = (uint32_t)(h ^ (h >> 32));
+    key->is_hash = true;
+    return key->hash;
+}
+
+#ifndef coc_hash_value
+   #define coc_hash_value coc_hash_wyhash
+#endif // coc_hash_value
+
+// Table operations use this: a key that was hashed before (every key
+// stored in an Instruction after its first lookup) costs no call
+#define coc_hash_cached(key) ((key)->is_hash ? (key)->hash : coc_hash_value(key))
+
+COCDEF int coc_ctz32(uint32_t x) {
+    COC_ASSERT(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    while (!(x & 1u)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif // __GNUC__
+}
+
+COCDEF uint8_t coc_ht_h2(uint32_t hash) {
+    return (uint8_t)(hash & 0x7F);
+}
+
+COCDEF uint32_t coc_ht_group_match(const uint8_t *group, uint8_t h2) {
+#ifdef COC_HT_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < COC_HT_GROUP; i++) mask |= (uint32_t)(group[i] == h2) << i;
+    return mask;
+#endif // COC_HT_SSE2
+}
+
+COCDEF uint32_t coc_ht_group_empty(const uint8_t *group) {
+    return coc_ht_group_match(group, COC_HT_EMPTY);
+}
+
+// Empty and deleted slots are the only control bytes with the high bit set
+COCDEF uint32_t coc_ht_group_free(const uint8_t *group) {
+#ifdef COC_HT_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < COC_HT_GROUP; i++) mask |= (uint32_t)(group[i] >> 7) << i;
+    return mask;
+#endif // COC_HT_SSE2
+}
+
+// Returns the slot holding key, or SIZE_MAX. Entry i's key is found at
+// keys + i * stride, so this works for any Entry type. Always inlined so
+// that stride folds to a constant at every lookup site.
+COC_FORCE_INLINE size_t coc_ht_lookup(const uint8_t *ctrl, size_t capacity, const char *keys,
+                            size_t stride, Coc_String *key, uint32_t hash) {
+    size_t group_mask = capacity / COC_HT_GROUP - 1;
+    size_t g = (hash >> 7) & group_mask;
+    uint8_t h2 = coc_ht_h2(hash);
+    for (size_t step = 1; ; step++) {
+        const uint8_t *group = ctrl + g * COC_HT_GROUP;
+        uint32_t match = coc_ht_group_match(group, h2);
+        while (match) {
+            size_t i = g * COC_HT_GROUP + coc_ctz32(match);
+            Coc_String *cand = (Coc_String *)(keys + i * stride);
+            if (cand->hash == hash && coc_str_eq(cand, key)) return i;
+            match &= match - 1;
+        }
+        if (coc_ht_group_empty(group)) return SIZE_MAX;
+        g = (g + step) & group_mask;
+    }
+}
+
+// Returns the first empty or deleted slot on the probe sequence of hash
+COCDEF size_t coc_ht_find_free(const uint8_t *ctrl, size_t capacity, uint32_t hash) {
+    size_t group_mask = capacity / COC_HT_GROUP - 1;
+    size_t g = (hash >> 7) & group_mask;
+    for (size_t step = 1; ; step++) {
+        uint32_t free_mask = coc_ht_group_free(ctrl + g * COC_HT_GROUP);
+        if (free_mask) return g * COC_HT_GROUP + coc_ctz32(free_mask);
+        g = (g + step) & group_mask;
+    }
+}
+
+// A deleted slot can go back to empty when its group still has an empty
+// slot: no probe sequence has ever continued past such a group.
+COCDEF void coc_ht_erase_slot(uint8_t *ctrl, size_t idx, size_t *tombstones) {
+    const uint8_t *group = ctrl + (idx & ~(size_t)(COC_HT_GROUP - 1));
+    if (coc_ht_group_empty(group)) {
+        ctrl[idx] = COC_HT_EMPTY;
+    } else {
+        ctrl[idx] = COC_HT_DELETED;
+        (*tombstones)++;
+    }
+}
 
-#define coc_ht_resize(ht, required_size) do {                                      \
+#define coc_ht_keys(ht) ((const char *)&(ht)->items[0].key)
+
+// Groups a successful lookup visits for the key stored in slot idx
+COCDEF size_t coc_ht_probe_length(size_t capacity, size_t idx, uint32_t hash) {
+    size_t group_mask = capacity / COC_HT_GROUP - 1;
+    size_t g = (hash >> 7) & group_mask;
+    size_t target = idx / COC_HT_GROUP;
+    size_t length = 1;
+    for (size_t step = 1; g != target && step <= group_mask + 1; step++) {
+        g = (g + step) & group_mask;
+        length++;
+    }
+    return length;
+}
+
+typedef struct Coc_Ht_Stats {
+    size_t size;
+    size_t capacity;
+    size_t tombstones;
+    size_t bytes;       // entries, control bytes and heap-allocated keys
+    size_t probe_total; // groups visited, summed over all stored keys
+    size_t probe_max;
+} Coc_Ht_Stats;
+
+#define coc_ht_stats(ht, stats) do {                                               \
     COC_ASSERT((ht) != NULL);                                                      \
-    if (required_size > (ht)->capacity * COC_HT_LOAD_FACTOR) {                     \
-        size_t new_capacity = (ht)->capacity == 0 ?                                \
-                                  COC_HT_INIT_CAP : (ht)->capacity * 2;            \
-        while (required_size > new_capacity * COC_HT_LOAD_FACTOR)                  \
-            new_capacity *= 2;                                                     \
-        (ht)->new_items = COC_CALLOC(new_capacity, sizeof(*(ht)->items));          \
-        COC_ASSERT((ht)->new_items != NULL);                                       \
-        for (size_t i = 0; i < (ht)->capacity; i++) {                              \
-            if ((ht)->items[i].is_used) {                                          \
-                uint32_t idx = coc_hash_value(&(ht)->items[i].key) % new_capacity; \
-                while ((ht)->new_items[idx].is_used)                               \
-                    idx = (idx + 1) % new_capacity;                                \
-                (ht)->new_items[idx] = (ht)->items[i];                             \
-            }                                                                      \
-        }                                                                          \
-        COC_FREE((ht)->items);                                                     \
-        (ht)->items = (ht)->new_items;                                             \
-        (ht)->capacity = new_capacity;                                             \
+    Coc_Ht_Stats *__coc_st = (stats);                                              \
+    *__coc_st = (Coc_Ht_Stats){0};                                                 \
+    __coc_st->size       = (ht)->size;                                             \
+    __coc_st->capacity   = (ht)->capacity;                                         \
+    __coc_st->tombstones = (ht)->tombstones;                                       \
+    __coc_st->bytes      = (ht)->capacity * (sizeof(*(ht)->items) + 1);            \
+    for (size_t i = 0; i < (ht)->capacity; i++) {                                  \
+        if (!(ht)->items[i].is_used) continue;                                     \
+        Coc_String *__coc_key = &(ht)->items[i].key;                               \
+        if (__coc_key->not_sso) __coc_st->bytes += __coc_key->capacity;            \
+        size_t __coc_len = coc_ht_probe_length((ht)->capacity, i,                  \
+                                               coc_hash_cached(__coc_key));        \
+        __coc_st->probe_total += __coc_len;                                        \
+        if (__coc_len > __coc_st->probe_max) __coc_st->probe_max = __coc_len;      \
     }                                                                              \
 } while (0)
 
-#define coc_ht_insert_move(ht, k, v) do {                    \
-    COC_ASSERT((ht) != NULL);                                \
-    COC_ASSERT((k) != NULL);                                 \
-    coc_ht_resize(ht, (ht)->size + 1);                       \
-    uint32_t __coc_idx = coc_hash_value(k) % (ht)->capacity; \
-    bool found = false;                                      \
-    while ((ht)->items[__coc_idx].is_used) {                 \
-        if (coc_str_eq(&(ht)->items[__coc_idx].key, k)) {    \
-            (ht)->items[__coc_idx].value = (v);              \
-            coc_str_free(k);                                 \
-            found = true;                                    \
-            break;                                           \
-        }                                                    \
-        __coc_idx = (__coc_idx + 1) % (ht)->capacity;        \
-    }                                                        \
-    if (found) break;                                        \
-    (ht)->items[__coc_idx].key     = coc_str_move(k);        \
-    (ht)->items[__coc_idx].value   = (v);                    \
-    (ht)->items[__coc_idx].is_used = true;                   \
-    (ht)->size++;                                            \
+#define coc_ht_resize(ht, required_size) do {                                          \
+    COC_ASSERT((ht) != NULL);                                                          \
+    if ((required_size) + (ht)->tombstones > (ht)->capacity * COC_HT_LOAD_FACTOR) {    \
+        size_t new_capacity = COC_HT_INIT_CAP;                                         \
+        while ((required_size) > new_capacity * COC_HT_LOAD_FACTOR)                    \
+            new_capacity *= 2;                                                         \
+        COC_ASSERT(new_capacity % COC_HT_GROUP == 0);                                  \
+        (ht)->new_items = COC_CALLOC(new_capacity, sizeof(*(ht)->items));              \
+        uint8_t *__coc_new_ctrl = COC_MALLOC(new_capacity);                            \
+        COC_ASSERT((ht)->new_items != NULL && __coc_new_ctrl != NULL);                 \
+        memset(__coc_new_ctrl, COC_HT_EMPTY, new_capacity);                            \
+        for (size_t i = 0; i < (ht)->capacity; i++) {                                  \
+            if (!(ht)->items[i].is_used) continue;                                     \
+            uint32_t __coc_hash = coc_hash_value(&(ht)->items[i].key);                 \
+            size_t __coc_idx = coc_ht_find_free(__coc_new_ctrl, new_capacity,          \
+                                                __coc_hash);                           \
+            __coc_new_ctrl[__coc_idx] = coc_ht_h2(__coc_hash);                         \
+            (ht)->new_items[__coc_idx] = (ht)->items[i];                               \
+        }                                                                              \
+        COC_FREE((ht)->items);                                                         \
+        COC_FREE((ht)->ctrl);                                                          \
+        (ht)->items      = (ht)->new_items;                                            \
+        (ht)->ctrl       = __coc_new_ctrl;                                             \
+        (ht)->capacity   = new_capacity;                                               \
+        (ht)->tombstones = 0;                                                          \
+    }                                                                                  \
+} while (0)
+
+#define coc_ht_insert_move(ht, k, v) do {                                 \
+    COC_ASSERT((ht) != NULL);                                             \
+    COC_ASSERT((k) != NULL);                                              \
+    coc_ht_resize(ht, (ht)->size + 1);                                    \
+    uint32_t __coc_hash = coc_hash_cached(k);                             \
+    size_t __coc_idx = coc_ht_lookup((ht)->ctrl, (ht)->capacity,          \
+                                     coc_ht_keys(ht), sizeof(*(ht)->items), \
+                                     k, __coc_hash);                      \
+    if (__coc_idx != SIZE_MAX) {                                          \
+        (ht)->items[__coc_idx].value = (v);                               \
+        coc_str_free(k);                                                  \
+        break;                                                            \
+    }                                                                     \
+    __coc_idx = coc_ht_find_free((ht)->ctrl, (ht)->capacity, __coc_hash); \
+    if ((ht)->ctrl[__coc_idx] == COC_HT_DELETED) (ht)->tombstones--;      \
+    (ht)->ctrl[__coc_idx]          = coc_ht_h2(__coc_hash);               \
+    (ht)->items[__coc_idx].key     = coc_str_move(k);                     \
+    (ht)->items[__coc_idx].value   = (v);                                 \
+    (ht)->items[__coc_idx].is_used = true;                                \
+    (ht)->size++;                                                         \
 } while (0)
 
 #define coc_ht_insert_copy(ht, k, v) do {       \
@@ -515,25 +1591,29 @@ COCDEF uint32_t coc_hash_fnv1a(Coc_String *key) {
     coc_ht_insert_move(ht, &__coc_new_key, v); \
 } while (0)
 
-#define coc_ht_find(ht, k, v_ptr) do {                       \
-    COC_ASSERT((ht) != NULL);                                \
-    COC_ASSERT((k) != NULL);                                 \
-    if ((ht)->size == 0) {                                   \
-        (v_ptr) = NULL;                                      \
-        break;                                               \
-    }                                                        \
-    uint32_t __coc_idx = coc_hash_value(k) % (ht)->capacity; \
-    for (size_t i = 0; i < (ht)->capacity; i++) {            \
-        if (!(ht)->items[__coc_idx].is_used) {               \
-            (v_ptr) = NULL;                                  \
-            break;                                           \
-        }                                                    \
-        if (coc_str_eq(&(ht)->items[__coc_idx].key, k)) {    \
-            (v_ptr) = &(ht)->items[__coc_idx].value;         \
-            break;                                           \
-        }                                                    \
-        __coc_idx = (__coc_idx + 1) % (ht)->capacity;        \
-    }                                                        \
+#define coc_ht_find(ht, k, v_ptr) do {                                        \
+    COC_ASSERT((ht) != NULL);                                                 \
+    COC_ASSERT((k) != NULL);                                                  \
+    (v_ptr) = NULL;                                                           \
+    if ((ht)->size == 0) break;                                               \
+    size_t __coc_idx = coc_ht_lookup((ht)->ctrl, (ht)->capacity,              \
+                                     coc_ht_keys(ht), sizeof(*(ht)->items),   \
+                                     k, coc_hash_cached(k));                  \
+    if (__coc_idx != SIZE_MAX) (v_ptr) = &(ht)->items[__coc_idx].value;       \
+} while (0)
+
+#define coc_ht_remove(ht, k) do {                                             \
+    COC_ASSERT((ht) != NULL);                                                 \
+    COC_ASSERT((k) != NULL);                                                  \
+    if ((ht)->size == 0) break;                                               \
+    size_t __coc_idx = coc_ht_lookup((ht)->ctrl, (ht)->capacity,              \
+                                     coc_ht_keys(ht), sizeof(*(ht)->items),   \
+                                     k, coc_hash_cached(k));                  \
+    if (__coc_idx == SIZE_MAX) break;                                         \
+    coc_str_free(&(ht)->items[__coc_idx].key);                                \
+    (ht)->items[__coc_idx].is_used = false;                                   \
+    coc_ht_erase_slot((ht)->ctrl, __coc_idx, &(ht)->tombstones);              \
+    (ht)->size--;                                                             \
 } while (0)
 
 #define coc_ht_find_cstr(ht, cstr, v_ptr) do { \
@@ -559,9 +1639,158 @@ COCDEF uint32_t coc_hash_fnv1a(Coc_String *key) {
         }                                         \
     }                                             \
     COC_FREE((ht)->items);                        \
-    (ht)->items    = NULL;                        \
-    (ht)->size     = 0;                           \
-    (ht)->capacity = 0;                           \
+    COC_FREE((ht)->ctrl);                         \
+    (ht)->items      = NULL;                      \
+    (ht)->ctrl       = NULL;                      \
+    (ht)->size       = 0;                         \
+    (ht)->tombstones = 0;                         \
+    (ht)->capacity   = 0;                         \
+} while (0)
+
+// dst becomes an independent copy of src with the same slot layout: the
+// entry and control arrays are copied flat, only heap keys are duplicated
+#define coc_ht_copy(dst, src) do {                                              \
+    COC_ASSERT((dst) != NULL && (src) != NULL);                                 \
+    *(dst) = (src)[0];                                                          \
+    (dst)->new_items = NULL;                                                    \
+    if ((src)->capacity == 0) break;                                            \
+    (dst)->items = COC_MALLOC((src)->capacity * sizeof(*(src)->items));         \
+    (dst)->ctrl  = COC_MALLOC((src)->capacity);                                 \
+    COC_ASSERT((dst)->items != NULL && (dst)->ctrl != NULL);                    \
+    memcpy((dst)->items, (src)->items, (src)->capacity * sizeof(*(src)->items)); \
+    memcpy((dst)->ctrl, (src)->ctrl, (src)->capacity);                          \
+    for (size_t i = 0; i < (src)->capacity; i++) {                              \
+        if ((dst)->items[i].is_used && (dst)->items[i].key.not_sso)             \
+            (dst)->items[i].key = coc_str_copy(&(src)->items[i].key);           \
+    }                                                                           \
+} while (0)
+
+// IntEntry format:
+// typedef struct IntEntry {
+//     uint64_t  key;
+//     long long value;
+//     bool      is_used;
+// } IntEntry;
+
+// typedef struct IntHashTable {
+//     IntEntry *items;
+//     IntEntry *new_items;
+//     uint8_t  *ctrl;
+//     size_t    size;
+//     size_t    tombstones;
+//     size_t    capacity;
+// } IntHashTable;
+
+// Same control-byte layout as coc_ht_*, keyed by uint64_t (instruction
+// indices, slot ids, packed strings) with no key storage or string hashing.
+
+// Murmur3 fmix64 finalizer, folded to 32 bits
+COCDEF uint32_t coc_hash_u64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return (uint32_t)(x ^ (x >> 32));
+}
+
+COCDEF size_t coc_iht_lookup(const uint8_t *ctrl, size_t capacity, const char *keys,
+                             size_t stride, uint64_t key, uint32_t hash) {
+    size_t group_mask = capacity / COC_HT_GROUP - 1;
+    size_t g = (hash >> 7) & group_mask;
+    uint8_t h2 = coc_ht_h2(hash);
+    for (size_t step = 1; ; step++) {
+        const uint8_t *group = ctrl + g * COC_HT_GROUP;
+        uint32_t match = coc_ht_group_match(group, h2);
+        while (match) {
+            size_t i = g * COC_HT_GROUP + coc_ctz32(match);
+            if (*(const uint64_t *)(keys + i * stride) == key) return i;
+            match &= match - 1;
+        }
+        if (coc_ht_group_empty(group)) return SIZE_MAX;
+        g = (g + step) & group_mask;
+    }
+}
+
+#define coc_iht_resize(ht, required_size) do {                                         \
+    COC_ASSERT((ht) != NULL);                                                          \
+    if ((required_size) + (ht)->tombstones > (ht)->capacity * COC_HT_LOAD_FACTOR) {    \
+        size_t new_capacity = COC_HT_INIT_CAP;                                         \
+        while ((required_size) > new_capacity * COC_HT_LOAD_FACTOR)                    \
+            new_capacity *= 2;                                                         \
+        (ht)->new_items = COC_CALLOC(new_capacity, sizeof(*(ht)->items));              \
+        uint8_t *__coc_new_ctrl = COC_MALLOC(new_capacity);                            \
+        COC_ASSERT((ht)->new_items != NULL && __coc_new_ctrl != NULL);                 \
+        memset(__coc_new_ctrl, COC_HT_EMPTY, new_capacity);                            \
+        for (size_t i = 0; i < (ht)->capacity; i++) {                                  \
+            if (!(ht)->items[i].is_used) continue;                                     \
+            uint32_t __coc_hash = coc_hash_u64((ht)->items[i].key);                    \
+            size_t __coc_idx = coc_ht_find_free(__coc_new_ctrl, new_capacity,          \
+                                                __coc_hash);                           \
+            __coc_new_ctrl[__coc_idx] = coc_ht_h2(__coc_hash);                         \
+            (ht)->new_items[__coc_idx] = (ht)->items[i];                               \
+        }                                                                              \
+        COC_FREE((ht)->items);                                                         \
+        COC_FREE((ht)->ctrl);                                                          \
+        (ht)->items      = (ht)->new_items;                                            \
+        (ht)->ctrl       = __coc_new_ctrl;                                             \
+        (ht)->capacity   = new_capacity;                                               \
+        (ht)->tombstones = 0;                                                          \
+    }                                                                                  \
+} while (0)
+
+#define coc_iht_insert(ht, k, v) do {                                              \
+    COC_ASSERT((ht) != NULL);                                                      \
+    uint64_t __coc_key = (uint64_t)(k);                                            \
+    coc_iht_resize(ht, (ht)->size + 1);                                            \
+    uint32_t __coc_hash = coc_hash_u64(__coc_key);                                 \
+    size_t __coc_idx = coc_iht_lookup((ht)->ctrl, (ht)->capacity,                  \
+                                      coc_ht_keys(ht), sizeof(*(ht)->items),       \
+                                      __coc_key, __coc_hash);                      \
+    if (__coc_idx == SIZE_MAX) {                                                   \
+        __coc_idx = coc_ht_find_free((ht)->ctrl, (ht)->capacity, __coc_hash);     \
+        if ((ht)->ctrl[__coc_idx] == COC_HT_DELETED) (ht)->tombstones--;           \
+        (ht)->ctrl[__coc_idx]          = coc_ht_h2(__coc_hash);                    \
+        (ht)->items[__coc_idx].key     = __coc_key;                                \
+        (ht)->items[__coc_idx].is_used = true;                                     \
+        (ht)->size++;                                                              \
+    }                                                                              \
+    (ht)->items[__coc_idx].value = (v);                                            \
+} while (0)
+
+#define coc_iht_find(ht, k, v_ptr) do {                                             \
+    COC_ASSERT((ht) != NULL);                                                       \
+    (v_ptr) = NULL;                                                                 \
+    if ((ht)->size == 0) break;                                                     \
+    uint64_t __coc_key = (uint64_t)(k);                                             \
+    size_t __coc_idx = coc_iht_lookup((ht)->ctrl, (ht)->capacity,                   \
+                                      coc_ht_keys(ht), sizeof(*(ht)->items),        \
+                                      __coc_key, coc_hash_u64(__coc_key));          \
+    if (__coc_idx != SIZE_MAX) (v_ptr) = &(ht)->items[__coc_idx].value;             \
+} while (0)
+
+#define coc_iht_remove(ht, k) do {                                                  \
+    COC_ASSERT((ht) != NULL);                                                       \
+    if ((ht)->size == 0) break;                                                     \
+    uint64_t __coc_key = (uint64_t)(k);                                             \
+    size_t __coc_idx = coc_iht_lookup((ht)->ctrl, (ht)->capacity,                   \
+                                      coc_ht_keys(ht), sizeof(*(ht)->items),        \
+                                      __coc_key, coc_hash_u64(__coc_key));          \
+    if (__coc_idx == SIZE_MAX) break;                                               \
+    (ht)->items[__coc_idx].is_used = false;                                         \
+    coc_ht_erase_slot((ht)->ctrl, __coc_idx, &(ht)->tombstones);                    \
+    (ht)->size--;                                                                   \
+} while (0)
+
+#define coc_iht_free(ht) do {        \
+    COC_ASSERT((ht) != NULL);        \
+    COC_FREE((ht)->items);           \
+    COC_FREE((ht)->ctrl);            \
+    (ht)->items      = NULL;         \
+    (ht)->ctrl       = NULL;         \
+    (ht)->size       = 0;            \
+    (ht)->tombstones = 0;            \
+    (ht)->capacity   = 0;            \
 } while (0)
 
 COCDEF size_t coc_kv_split(const char *arg, const char **value) {
@@ -587,6 +1816,18 @@ COCDEF bool coc_kv_match(const char *arg, size_t arg_len, const char *option) {
 #ifdef COC_IMPLEMENTATION
 
 Coc_Log_Config coc_global_log_config = {0};
+COC_THREAD_LOCAL Coc_Log_Config *coc_thread_log_config = NULL;
+COC_THREAD_LOCAL Coc_Arena      *coc_global_arena      = NULL;
+Coc_Heap_Stats coc_global_heap       = {0};
+
+#ifndef COC_NO_THREADS
+Coc_Log_Async coc_global_log_async = {
+    .lock     = PTHREAD_MUTEX_INITIALIZER,
+    .wake     = PTHREAD_COND_INITIALIZER,
+    .space    = PTHREAD_COND_INITIALIZER,
+    .key_once = PTHREAD_ONCE_INIT
+};
+#endif // COC_NO_THREADS
 
 #endif // COC_IMPLEMENTATION
 
@@ -595,6 +1836,143 @@ Coc_Log_Config coc_global_log_config = {0};
 /*
 Recent Revision History:
 
+1.16.2 (2026-10-18)
+
+Changed:
+- coc_ht_lookup() is always inlined
+- hash table macros read a cached key hash inline (coc_hash_cached)
+
+1.16.1 (2026-10-18)
+
+Changed:
+- the async log thread blocks all signals
+
+1.16.0 (2026-10-18)
+
+Added:
+- Coc_Log_Ring.owned, coc_log_ring_release(): a pthread key destructor hands
+  the ring of an exiting thread to the consumer, which frees it once drained
+- Coc_Log_Async.space: producers wait on it while their ring is full
+
+Removed:
+- Coc_Log_Ring.generation, Coc_Log_Async.generation
+
+Fixed:
+- coc_log_async_stop() freed rings that live threads still pointed to
+- rings of exited threads were never freed
+- producers spun on sched_yield() while their ring was full
+
+1.15.0 (2026-10-18)
+
+Added:
+- coc_arena_release(): free a large arena allocation, used by COC_FREE
+
+Changed:
+- arena allocations of COC_ARENA_LARGE bytes or more are malloc'ed one by
+  one, so growing or freeing them no longer leaves a dead copy behind
+
+1.14.0 (2026-10-18)
+
+Added:
+- coc_arena_merge(): move the blocks of one arena into another
+
+1.13.0 (2026-10-18)
+
+Added:
+- coc_ht_copy(): flat copy of a hash table
+
+1.12.0 (2026-10-18)
+
+Added:
+- coc_thread_log_config, coc_log_use(), coc_log_current(): per-thread log configuration
+
+Changed:
+- coc_global_arena is thread-local
+- coc_global_heap counters are atomic unless COC_NO_THREADS is defined
+
+1.11.0 (2026-10-18)
+
+Added:
+- COC_LIKELY(), COC_UNLIKELY() branch hints
+
+1.10.0 (2026-10-18)
+
+Added:
+- Coc_Heap_Stats, coc_global_heap: peak and current heap through the default COC_MALLOC hooks
+- coc_alloc_size(), coc_heap_stats_available()
+- Coc_Ht_Stats, coc_ht_stats(), coc_ht_probe_length()
+
+1.9.0 (2026-10-18)
+
+Added:
+- coc_now_ns(), monotonic clock in nanoseconds
+- coc_cycles(), time stamp counter (falls back to coc_now_ns())
+- COC_FORCE_INLINE, COC_COLD
+
+1.8.0 (2026-10-18)
+
+Added:
+- COC_LOG_COMPILED_MIN_LEVEL, coc_log() below it compiles to nothing
+- coc_log_enabled(level) for cheap runtime filtering
+- COC_LOG_PRINTF, coc_log() arguments are checked against the format
+
+Changed:
+- coc_log() is a macro over coc_log_fmt(), arguments are only evaluated when the level is enabled
+- coc_log_raw() honours COC_LOG_COMPILED_MIN_LEVEL
+
+1.7.0 (2026-10-18)
+
+Added:
+- use_async (in Coc_Log_Config), asynchronous logging through per-thread rings
+- coc_log_flush(), coc_log_format_time(), COC_THREAD_LOCAL, COC_NO_THREADS
+- COC_LOG_LINE_MAX, COC_LOG_RING_CAP, COC_LOG_DRAIN_MS
+
+Changed:
+- coc_log_core() formats each line once and writes it with a single call
+- date and time strings are cached per second
+- coc_log_reopen() keeps the log thread running
+
+1.6.2 (2026-10-18)
+
+Added:
+- coc_hash_wyhash(), coc_wymix(), coc_read_u64(), coc_read_u32()
+
+Changed:
+- coc_hash_value defaults to coc_hash_wyhash, define it before including coc.h to select another
+
+1.6.1 (2026-10-18)
+
+Added:
+- IntHashTable format, coc_hash_u64()
+- coc_iht_lookup(), coc_iht_resize(), coc_iht_insert(), coc_iht_find(), coc_iht_remove(), coc_iht_free()
+
+1.6.0 (2026-10-18)
+
+Added:
+- ctrl, tombstones (in HashTable struct)
+- COC_HT_GROUP, COC_HT_EMPTY, COC_HT_DELETED, COC_HT_SSE2
+- coc_ht_lookup(), coc_ht_find_free(), coc_ht_erase_slot(), coc_ht_group_match()
+- coc_ht_remove(), coc_ctz32()
+
+Changed:
+- coc_ht_* use Swiss-table control bytes with group probing and mask indexing
+- coc_ht_find() compares the stored hash before the key and stops at an empty group
+
+1.5.1 (2026-10-18)
+
+Added:
+- Coc_File_Map, coc_map_file(), coc_unmap_file()
+
+1.5.0 (2026-10-18)
+
+Added:
+- Coc_Arena, coc_arena_alloc(), coc_arena_realloc(), coc_arena_owns(), coc_arena_free()
+- coc_arena_begin(), coc_arena_end(), coc_global_arena
+- coc_malloc(), coc_realloc(), coc_calloc(), coc_free()
+
+Changed:
+- default COC_MALLOC / COC_REALLOC / COC_CALLOC / COC_FREE go through the active arena
+
 1.4.1 (2026-01-16)
 
 Added:
@@ -15,6 +15,12 @@ int main(int argc, char *argv[]) {
     };
     const char *filename = NULL;
     const char *log_file = NULL;
+    const char *batch = NULL;
+    const char *serve = NULL;
+    const char *client = NULL;
+    bool stream = false;
+    RunOptions opts = {0};
+    int metrics_interval_ms = METRICS_INTERVAL_MS;
     for (int i = 1; i < argc; i++) {
         const char *arg = argv[i];
         const char *value = NULL;
@@ -29,6 +35,103 @@ int main(int argc, char *argv[]) {
                 cfg.min_level = coc_log_level_from_cstr(value);
             } else if (coc_kv_match(arg, len, "--log-file")) {
                 log_file = value;
+            } else if (coc_kv_match(arg, len, "--log-async")) {
+                cfg.use_async = true;
+            } else if (coc_kv_match(arg, len, "--emit-bytecode")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --emit-bytecode requires a file name", argv[0]);
+                    return 1;
+                }
+                opts.emit_bytecode = value;
+            } else if (coc_kv_match(arg, len, "--bytecode-cache")) {
+                opts.use_cache = true;
+            } else if (coc_kv_match(arg, len, "--profile")) {
+                opts.profile = true;
+            } else if (coc_kv_match(arg, len, "--profile-json")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --profile-json requires a file name", argv[0]);
+                    return 1;
+                }
+                opts.profile_json = value;
+            } else if (coc_kv_match(arg, len, "--stats")) {
+                opts.stats = true;
+            } else if (coc_kv_match(arg, len, "--stats-json")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --stats-json requires a file name", argv[0]);
+                    return 1;
+                }
+                opts.stats_json = value;
+            } else if (coc_kv_match(arg, len, "--perf-counters")) {
+                opts.perf_counters = true;
+            } else if (coc_kv_match(arg, len, "--sample-profile")) {
+                int hz = value != NULL ? atoi(value) : 0;
+                if (hz <= 0 || hz > SAMPLE_MAX_HZ) {
+                    coc_log_raw(COC_ERROR, "%s: --sample-profile requires a rate in 1..%d Hz", argv[0], SAMPLE_MAX_HZ);
+                    return 1;
+                }
+                opts.sample_hz = hz;
+            } else if (coc_kv_match(arg, len, "--sample-output")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --sample-output requires a file name", argv[0]);
+                    return 1;
+                }
+                opts.sample_output = value;
+            } else if (coc_kv_match(arg, len, "--metrics")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --metrics requires a file name", argv[0]);
+                    return 1;
+                }
+                opts.metrics = value;
+            } else if (coc_kv_match(arg, len, "--metrics-interval")) {
+                int ms = value != NULL ? atoi(value) : -1;
+                if (ms < 0 || (ms == 0 && strcmp(value, "0") != 0)) {
+                    coc_log_raw(COC_ERROR, "%s: --metrics-interval requires milliseconds (0: only on SIGUSR1)", argv[0]);
+                    return 1;
+                }
+                metrics_interval_ms = ms;
+            } else if (coc_kv_match(arg, len, "--batch")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --batch requires a file listing the inputs", argv[0]);
+                    return 1;
+                }
+                batch = value;
+            } else if (coc_kv_match(arg, len, "--jobs")) {
+                int jobs = value != NULL ? atoi(value) : 0;
+                if (jobs <= 0) {
+                    coc_log_raw(COC_ERROR, "%s: --jobs requires a positive number of threads", argv[0]);
+                    return 1;
+                }
+                opts.jobs = jobs;
+                compile_jobs = jobs;
+            } else if (coc_kv_match(arg, len, "--serve")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --serve requires a socket path", argv[0]);
+                    return 1;
+                }
+                serve = value;
+            } else if (coc_kv_match(arg, len, "--client")) {
+                if (value == NULL || *value == '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --client requires a socket path", argv[0]);
+                    return 1;
+                }
+                client = value;
+            } else if (coc_kv_match(arg, len, "--stream")) {
+                stream = true;
+            } else if (coc_kv_match(arg, len, "--max-instructions")) {
+                char *end = NULL;
+                unsigned long long n = value != NULL ? strtoull(value, &end, 10) : 0;
+                if (n == 0 || *end != '\0') {
+                    coc_log_raw(COC_ERROR, "%s: --max-instructions requires a positive number", argv[0]);
+                    return 1;
+                }
+                opts.max_instructions = n;
+            } else if (coc_kv_match(arg, len, "--timeout")) {
+                int ms = value != NULL ? atoi(value) : 0;
+                if (ms <= 0) {
+                    coc_log_raw(COC_ERROR, "%s: --timeout requires a positive number of milliseconds", argv[0]);
+                    return 1;
+                }
+                opts.timeout_ms = ms;
             } else {
                 coc_log_raw(COC_ERROR, "%s: unknown option %.*s", argv[0], (int)len, arg);
                 return 1;
@@ -41,12 +144,67 @@ int main(int argc, char *argv[]) {
             }
         }
     }
+    opts.metrics_interval_ms = metrics_interval_ms;
     coc_log_init(cfg , log_file);
+    bool extra_opts = opts.emit_bytecode || opts.profile || opts.profile_json || opts.sample_hz ||
+                      opts.stats || opts.stats_json || opts.perf_counters || opts.metrics;
+#ifndef _WIN32
+    if (serve != NULL) {
+        if (filename != NULL || batch != NULL || client != NULL || extra_opts) {
+            coc_log_raw(COC_ERROR, "%s: --serve takes no input file and only combines with --jobs, --max-instructions and --timeout", argv[0]);
+            coc_log_close();
+            return 1;
+        }
+        int err = run_serve(serve, NULL, &opts);
+        if (err != 0) coc_log(COC_FATAL, "Cannot serve on %s: %s", serve, strerror(err));
+        coc_log_close();
+        return err == 0 ? 0 : 1;
+    }
+#endif // _WIN32
     if (filename == NULL) {
         coc_log_raw(COC_FATAL, "%s: no input file", argv[0]);
         return 1;
     }
-    VM *vm = run_file(filename, NULL);
+#ifndef _WIN32
+    if (stream) {
+        if (extra_opts || opts.use_cache || batch != NULL || client != NULL) {
+            coc_log_raw(COC_ERROR, "%s: --stream only combines with --max-instructions and --timeout", argv[0]);
+            coc_log_close();
+            return 1;
+        }
+        PunctaStatus status = run_stream_opts(filename, NULL, &opts);
+        coc_log_close();
+        return status == PUNCTA_OK ? 0 : 1;
+    }
+    if (batch != NULL) {
+        if (extra_opts || client != NULL) {
+            coc_log_raw(COC_ERROR, "%s: --batch only combines with --jobs, --bytecode-cache, --max-instructions and --timeout", argv[0]);
+            coc_log_close();
+            return 1;
+        }
+        int failed = run_batch_opts(filename, batch, NULL, &opts);
+        coc_log_close();
+        return failed == 0 ? 0 : 1;
+    }
+    if (client != NULL) {
+        if (extra_opts || opts.use_cache) {
+            coc_log_raw(COC_ERROR, "%s: --client only combines with --max-instructions and --timeout", argv[0]);
+            coc_log_close();
+            return 1;
+        }
+        // Without a server the program runs here, as if --client was not given
+        int status = run_client(client, filename, &opts);
+        if (status >= 0) {
+            coc_log_close();
+            return status == PUNCTA_OK ? 0 : 1;
+        }
+    }
+#endif // _WIN32
+    VM *vm = run_file_opts(filename, NULL, &opts);
+    if (vm == NULL) {
+        coc_log_close();
+        return 1;
+    }
     vm_free(vm);
     coc_log_close();
     return 0;
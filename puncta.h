@@ -1,15 +1,134 @@
-// puncta.h - version 1.0.8 (2026-01-15)
-// required coc.h >= 1.4.0
+// puncta.h - version 1.17.0 (2026-10-18)
+// required coc.h >= 1.14.0
 #ifndef PUNCTA_H_
 #define PUNCTA_H_
 
 #define PUNCTA_VERSION_MAJOR 1
-#define PUNCTA_VERSION_MINOR 0
-#define PUNCTA_VERSION_PATCH 8
+#define PUNCTA_VERSION_MINOR 17
+#define PUNCTA_VERSION_PATCH 0
 
 #include <math.h>
 #include <limits.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+   #include <fcntl.h>
+   #include <poll.h>
+   #include <sys/socket.h>
+   #include <sys/time.h>
+   #include <sys/un.h>
+   #include <unistd.h>
+#endif // _WIN32
+#ifdef __linux__
+   #include <linux/perf_event.h>
+   #include <sys/syscall.h>
+#endif // __linux__
 #include "coc.h"
+
+// Batches, serve mode, metrics and large compiles run on threads, and VM
+// counters shared with them are atomic
+#ifdef COC_NO_THREADS
+   #error "puncta.h needs threads: build it without COC_NO_THREADS"
+#endif // COC_NO_THREADS
+
+// Errors in the lexer, parser, VM, actions and eval! are raised with
+// puncta_raise(): the message is logged, then control unwinds to the
+// innermost PunctaTrap of the calling thread. Traps are installed by
+// compile_source() and vm_run(), so one failing program never takes down
+// other VMs in the process. Without a trap (an action called outside of
+// vm_run()) the process exits with status 1, as it always did.
+typedef enum PunctaStatus {
+    PUNCTA_OK,
+    PUNCTA_ERR_LEXICAL,
+    PUNCTA_ERR_SYNTAX,
+    PUNCTA_ERR_SEMANTIC,
+    PUNCTA_ERR_RUNTIME,
+    PUNCTA_ERR_INPUT,
+    PUNCTA_ERR_IO,
+    PUNCTA_ERR_MEMORY,
+    PUNCTA_ERR_LIMIT,   // --max-instructions or --timeout reached
+    PUNCTA_WAIT_INPUT   // not an error: the input would block, run the VM again later
+} PunctaStatus;
+
+#define PUNCTA_ERROR_LEN 256
+
+typedef struct PunctaError {
+    PunctaStatus status;
+    int          line;    // 0 when the error has no source line
+    char         message[PUNCTA_ERROR_LEN];
+} PunctaError;
+
+typedef struct PunctaTrap {
+    jmp_buf            env;
+    PunctaError       *error;
+    struct PunctaTrap *prev;
+} PunctaTrap;
+
+static COC_THREAD_LOCAL PunctaTrap  *puncta_trap = NULL;
+static COC_THREAD_LOCAL PunctaError  puncta_error; // last compile error of this thread
+
+// Call setjmp(trap->env) right after pushing, in the same function
+static inline void puncta_trap_push(PunctaTrap *trap, PunctaError *error) {
+    trap->error = error;
+    trap->prev  = puncta_trap;
+    puncta_trap = trap;
+}
+
+static inline void puncta_trap_pop(PunctaTrap *trap) {
+    puncta_trap = trap->prev;
+}
+
+static inline const char *puncta_status_name(PunctaStatus status) {
+    switch (status) {
+    case PUNCTA_OK          : return "ok";
+    case PUNCTA_ERR_LEXICAL : return "lexical";
+    case PUNCTA_ERR_SYNTAX  : return "syntax";
+    case PUNCTA_ERR_SEMANTIC: return "semantic";
+    case PUNCTA_ERR_RUNTIME : return "runtime";
+    case PUNCTA_ERR_INPUT   : return "input";
+    case PUNCTA_ERR_IO      : return "io";
+    case PUNCTA_ERR_MEMORY  : return "memory";
+    case PUNCTA_ERR_LIMIT   : return "limit";
+    case PUNCTA_WAIT_INPUT  : return "wait input";
+    }
+    return "unknown";
+}
+
+// The error that made the last compile_*() on this thread return NULL
+static inline const PunctaError *puncta_last_error(void) {
+    return &puncta_error;
+}
+
+_Noreturn COC_COLD static void puncta_raise(PunctaStatus status, int line, const char *fmt, ...) COC_LOG_PRINTF(3, 4);
+_Noreturn COC_COLD static void puncta_raise(PunctaStatus status, int line, const char *fmt, ...) {
+    PunctaError error = {.status = status, .line = line};
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(error.message, sizeof(error.message), fmt, args);
+    va_end(args);
+    bool fatal = status == PUNCTA_ERR_MEMORY || status == PUNCTA_ERR_IO;
+    coc_log(fatal ? COC_FATAL : COC_ERROR, "%s", error.message);
+    PunctaTrap *trap = puncta_trap;
+    if (trap == NULL) exit(1);
+    puncta_trap = trap->prev;
+    *trap->error = error;
+    longjmp(trap->env, 1);
+}
+
+// Unwinds like puncta_raise(), without a message: an action found no input
+// on a non-blocking stream and runs again when its VM is resumed
+_Noreturn COC_COLD static void puncta_wait_input(int line) {
+    PunctaTrap *trap = puncta_trap;
+    if (trap == NULL) {
+        puncta_raise(PUNCTA_ERR_IO, line, "Input error: the input would block");
+    }
+    puncta_trap = trap->prev;
+    *trap->error = (PunctaError){.status = PUNCTA_WAIT_INPUT, .line = line};
+    longjmp(trap->env, 1);
+}
+
+#define EVAL_FAIL(msg) puncta_raise(PUNCTA_ERR_RUNTIME, 0, "%s", msg)
 #include "puncta_eval.h"
 
 #define STRING_LEN (16 - 2 * sizeof(bool))
@@ -29,22 +148,19 @@ typedef struct Number {
 static inline int64_t number_trunc_i64(const Number *n, const char *who, int line) {
     if (!n->is_float) return (int64_t)n->int_value;
     if (!isfinite(n->float_value)) {
-        coc_log(COC_ERROR, "Runtime error at line %d: in action '%s': expects a finite number", line, who);
-        exit(1);
+        puncta_raise(PUNCTA_ERR_RUNTIME, line, "Runtime error at line %d: in action '%s': expects a finite number", line, who);
     }
     if (n->float_value > (double)LLONG_MAX || n->float_value < (double)LLONG_MIN) {
-        coc_log(COC_ERROR, "Runtime error at line %d: in action '%s' number out of int64 range", line, who);
-        exit(1);
+        puncta_raise(PUNCTA_ERR_RUNTIME, line, "Runtime error at line %d: in action '%s' number out of int64 range", line, who);
     }
     return (int64_t)n->float_value;
 }
 
 static inline size_t number_to_string(const Number *n, char *buf, size_t buf_size, const char *who, int line) {
     if (n->is_float) {
-        coc_log(COC_ERROR, 
+        puncta_raise(PUNCTA_ERR_RUNTIME, line, 
                 "Runtime error at line %d: in action '%s': cannot treat a floating-point value as a string (packed int64 required); got float=%g",
                 line, who, n->float_value);
-        exit(1);
     }
     uint64_t value = (uint64_t)n->int_value;
     size_t len = 0;
@@ -52,10 +168,9 @@ static inline size_t number_to_string(const Number *n, char *buf, size_t buf_siz
         unsigned char c = (value >> (i * PACK_LEN)) & 0xFF;
         if (c == '\0') break;
         if (len >= buf_size) {
-            coc_log(COC_ERROR,
+            puncta_raise(PUNCTA_ERR_RUNTIME, line,
                     "Runtime error at line %d: in action '%s': buffer too small for number-to-string conversion (need %zu bytes at least, have %zu)",
                     line, who, len + 1, buf_size);
-            exit(1);
         }
         buf[len++] = c;
     }
@@ -64,10 +179,9 @@ static inline size_t number_to_string(const Number *n, char *buf, size_t buf_siz
             char c = n->extra[i];
             if (c == '\0') break;
             if (len >= buf_size) {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_RUNTIME, line,
                         "Runtime error at line %d: in action '%s': buffer too small for extra number-to-string conversion (need %zu bytes at least, have %zu)",
                         line, who, len + 1, buf_size);
-                exit(1);
             }
             buf[len++] = c;
         }
@@ -89,6 +203,156 @@ typedef struct Token {
     int        line;
 } Token;
 
+// Phases of run_file(), timed (and counted with --perf-counters) through
+// perf_phase_begin()/perf_phase_end(). Both are no-ops unless a
+// PerfCounters is active. --stats uses the same timings with no counters
+// open, and additionally times the lexer inside the compile phase.
+typedef enum Phase {
+    PHASE_READ,
+    PHASE_COMPILE,
+    PHASE_LINK,
+    PHASE_LOAD,
+    PHASE_REGISTER,
+    PHASE_RUN,
+    PHASE_COUNT
+} Phase;
+
+static const char *phase_names[PHASE_COUNT] = {"read", "compile", "link", "load", "register", "run"};
+
+typedef enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+static const char *perf_event_names[PERF_EVENT_COUNT] = {"cycles", "instructions", "branch-misses", "L1d-misses"};
+
+typedef struct PerfCounters {
+    int      fds[PERF_EVENT_COUNT];   // -1 when the counter is unavailable
+    int      open_count;
+    bool     time_lexer;
+    bool     seen[PHASE_COUNT];
+    uint64_t lex_ns;                  // part of PHASE_COMPILE, with time_lexer
+    uint64_t load_link_ns;            // part of PHASE_LOAD: bytecode label checking
+    uint64_t ns[PHASE_COUNT];
+    uint64_t values[PHASE_COUNT][PERF_EVENT_COUNT];
+} PerfCounters;
+
+typedef struct PerfMark {
+    uint64_t ns;
+    uint64_t values[PERF_EVENT_COUNT];
+} PerfMark;
+
+// Per thread, so that concurrent run_file_opts() calls time their own phases
+static COC_THREAD_LOCAL PerfCounters *perf_counters = NULL;
+
+// No counters open, all phases at zero
+static inline void perf_init(PerfCounters *perf) {
+    *perf = (PerfCounters){0};
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) perf->fds[i] = -1;
+}
+
+// Opens every counter on its own, so that a missing one (L1d misses in
+// most VMs) does not take the others down. Returns the number opened.
+static inline int perf_open(PerfCounters *perf) {
+    perf_init(perf);
+#ifdef __linux__
+    static const struct { uint32_t type; uint64_t config; } events[PERF_EVENT_COUNT] = {
+        [PERF_CYCLES]        = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        [PERF_INSTRUCTIONS]  = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        [PERF_L1D_MISSES]    = {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        struct perf_event_attr attr = {0};
+        attr.size           = sizeof(attr);
+        attr.type           = events[i].type;
+        attr.config         = events[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0) {
+            coc_log(COC_DEBUG, "perf_event_open(%s): %s", perf_event_names[i], strerror(errno));
+            continue;
+        }
+        perf->fds[i] = fd;
+        perf->open_count++;
+    }
+#endif // __linux__
+    return perf->open_count;
+}
+
+static inline void perf_close(PerfCounters *perf) {
+#ifdef __linux__
+    for (int i = 0; i < PERF_EVENT_COUNT; i++)
+        if (perf->fds[i] >= 0) close(perf->fds[i]);
+#endif // __linux__
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) perf->fds[i] = -1;
+    perf->open_count = 0;
+}
+
+// Counter values scaled for multiplexing
+static inline void perf_read(PerfCounters *perf, uint64_t *values) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        values[i] = 0;
+#ifdef __linux__
+        uint64_t buf[3];
+        if (perf->fds[i] < 0 || read(perf->fds[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) continue;
+        values[i] = buf[2] > 0 && buf[2] < buf[1] ? (uint64_t)((double)buf[0] * buf[1] / buf[2]) : buf[0];
+#endif // __linux__
+    }
+}
+
+static inline void perf_phase_begin(PerfMark *mark) {
+    if (perf_counters == NULL) return;
+    perf_read(perf_counters, mark->values);
+    mark->ns = coc_now_ns();
+}
+
+static inline void perf_phase_end(Phase phase, PerfMark *mark) {
+    if (perf_counters == NULL) return;
+    uint64_t ns = coc_now_ns();
+    uint64_t values[PERF_EVENT_COUNT];
+    perf_read(perf_counters, values);
+    perf_counters->seen[phase] = true;
+    perf_counters->ns[phase]  += ns - mark->ns;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++)
+        perf_counters->values[phase][i] += values[i] - mark->values[i];
+}
+
+static inline void perf_print_value(FILE *out, const PerfCounters *perf, PerfEvent event, uint64_t value) {
+    if (perf->fds[event] < 0) fprintf(out, " %14s", "n/a");
+    else fprintf(out, " %14llu", (unsigned long long)value);
+}
+
+COC_COLD static void perf_report(const PerfCounters *perf, uint64_t steps, FILE *out) {
+    fprintf(out, "Performance counters:\n%-8s %10s", "phase", "ms");
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) fprintf(out, " %14s", perf_event_names[i]);
+    fprintf(out, " %6s\n", "IPC");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (!perf->seen[p]) continue;
+        const uint64_t *v = perf->values[p];
+        fprintf(out, "%-8s %10.3f", phase_names[p], perf->ns[p] / 1e6);
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) perf_print_value(out, perf, (PerfEvent)i, v[i]);
+        if (v[PERF_CYCLES] > 0 && perf->fds[PERF_INSTRUCTIONS] >= 0)
+            fprintf(out, " %6.2f\n", (double)v[PERF_INSTRUCTIONS] / v[PERF_CYCLES]);
+        else
+            fprintf(out, " %6s\n", "n/a");
+    }
+    if (!perf->seen[PHASE_RUN] || steps == 0) return;
+    fprintf(out, "\nPer Puncta instruction (%llu executed):\n", (unsigned long long)steps);
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (perf->fds[i] < 0) continue;
+        fprintf(out, "%-16s %10.3f\n", perf_event_names[i], (double)perf->values[PHASE_RUN][i] / steps);
+    }
+    fprintf(out, "%-16s %10.3f\n", "ns", (double)perf->ns[PHASE_RUN] / steps);
+}
+
 typedef struct Lexer {
     Coc_String src;
     size_t     pos;
@@ -98,8 +362,7 @@ typedef struct Lexer {
 static inline Lexer *lexer_init(Coc_String source) {
     Lexer *lex = (Lexer *)COC_MALLOC(sizeof(Lexer));
     if (lex == NULL) {
-    coc_log(COC_FATAL, "Lexer init: malloc() failed");
-        exit(1);
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Lexer init: malloc() failed");
     }
     lex->src  = source;
     lex->pos  = 0;
@@ -118,12 +381,12 @@ static inline char lexer_peek(Lexer *l) {
 }
 
 static inline char lexer_peek2(Lexer *l) {
-    if (l->pos + 1 >= l->src.size) return '\0';
+    if (l->pos + 1 >= coc_str_size(&l->src)) return '\0';
     return coc_str_data(&l->src)[l->pos + 1];
 }
 
 static inline char lexer_get(Lexer *l) {
-    if (l->pos >= l->src.size) return '\0';
+    if (l->pos >= coc_str_size(&l->src)) return '\0';
     return coc_str_data(&l->src)[l->pos++];
 }
 
@@ -146,10 +409,9 @@ static inline void skip_comment(Lexer *l) {
             case ')': depth--; break;
             case '\n': l->line++; break;
             case '\0':
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, start_line,
                         "Lexical error at line %d: unterminated comment",
                         start_line);
-                exit(1);
             }
         }
         skip_whitespace(l);
@@ -170,10 +432,9 @@ static inline Token lexer_next(Lexer *l) {
     skip_comment(l);
     char c = lexer_peek(l);
     if (c == ')') {
-        coc_log(COC_ERROR,
+        puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                 "Lexical error at line %d: unmatched ')'",
                 l->line);
-        exit(1);
     }
     if (c == '\0') return (Token){.kind = tok_eof, .line = l->line};
     if (isalpha(c) || c == '_') {
@@ -207,10 +468,9 @@ static inline Token lexer_next(Lexer *l) {
         }
         char next_char = lexer_peek(l);
         if (!is_token_boundary(next_char)) {
-            coc_log(COC_ERROR, 
+            puncta_raise(PUNCTA_ERR_LEXICAL, l->line, 
                     "Lexical error at line %d: invalid character '%c' after %s literal",
                     l->line, next_char, is_float ? "floating-point" : (is_hex ? "hexadecimal integer" : "decimal integer"));
-            exit(1);
         }
         coc_str_append_null(&num);
         char *end_ptr = NULL;
@@ -218,16 +478,14 @@ static inline Token lexer_next(Lexer *l) {
         if (is_float) {
             double float_val = strtod(coc_str_data(&num), &end_ptr);
             if (end_ptr == coc_str_data(&num)) {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                         "Lexical error at line %d: invalid floating-point literal",
                         l->line);
-                exit(1);
             }
             if (errno == ERANGE) {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                         "Lexical error at line %d: floating-point literal out of range",
                         l->line);
-                exit(errno);
             }
             return (Token){
                 .kind = tok_number,
@@ -240,16 +498,14 @@ static inline Token lexer_next(Lexer *l) {
         } else {
             long long int_val = strtoll(coc_str_data(&num), &end_ptr, is_hex ? 16 : 10);
             if (end_ptr == coc_str_data(&num)) {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                         "Lexical error at line %d: invalid %s integer literal",
                         l->line, is_hex ? "hexadecimal" : "decimal");
-                exit(1);
             }
             if (errno == ERANGE) {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                         "Lexical error at line %d: %s integer literal out of range",
                         l->line, is_hex ? "hexadecimal" : "decimal");
-                exit(errno);
             }
             return (Token){
                 .kind = tok_number,
@@ -268,17 +524,15 @@ static inline Token lexer_next(Lexer *l) {
         while (lexer_peek(l) && lexer_peek(l) != '"') {
             if (len >= PACK_LEN) num.is_extra = true;
             if (len >= STRING_LEN) {
-                coc_log(COC_ERROR,
-                        "Lexical error at line %d: string literal too long (max %lld characters allowed)",
-                        l->line, STRING_LEN);
-                exit(1);
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
+                        "Lexical error at line %d: string literal too long (max %zu characters allowed)",
+                        l->line, (size_t)STRING_LEN);
             }
             char ch = lexer_get(l);
             if (ch == '\n') {
-                coc_log(COC_ERROR,
+                puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                         "Lexical error at line %d: unescaped '\\n' in string literal",
                         l->line);
-                exit(1);
             }
             if (ch == '\\') {
                 char esc = lexer_get(l);
@@ -293,25 +547,22 @@ static inline Token lexer_next(Lexer *l) {
                 case '"': ch = '"' ; break;
                 case '\\':ch = '\\'; break;
                 case '\0':
-                    coc_log(COC_ERROR,
+                    puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                             "Lexical error at line %d: unterminated escape sequence",
                             l->line);
-                    exit(1);
                 default:
-                    coc_log(COC_ERROR,
+                    puncta_raise(PUNCTA_ERR_LEXICAL, l->line,
                             "Lexical error at line %d: invalid escape sequence \\%c",
                             l->line, esc);
-                    exit(1);
                 }
             }
             if (!num.is_extra) num.int_value |= ((uint64_t)ch & 0xFF) << ((len++) * PACK_LEN);
             else num.extra[(len++) - PACK_LEN] = ch;
         }
         if (lexer_peek(l) != '"') {
-            coc_log(COC_ERROR, 
+            puncta_raise(PUNCTA_ERR_LEXICAL, l->line, 
                     "Lexical error at line %d: unterminated string (missing '\"')",
                     l->line);
-            exit(1);
         }
         lexer_get(l);
         return (Token){
@@ -335,7 +586,9 @@ typedef enum OpCode {
     OP_ACT,
     OP_JEQ,
     OP_JMP,
-    OP_END
+    OP_END,
+    OP_CALL,    // L@;  jump to L, pushing the return address
+    OP_RET      // @;   pop the return address and jump back
 } OpCode;
 
 typedef struct Instruction {
@@ -345,6 +598,7 @@ typedef struct Instruction {
     Number     number;
     OpCode     op;
     int        line;
+    int        target;      // jumps: instruction index; actions: builtin slot; -1: look up by name
     bool       is_B_number;
 } Instruction;
 
@@ -363,7 +617,9 @@ typedef struct LabelEntry {
 typedef struct LabelHashTable {
     LabelEntry *items;
     LabelEntry *new_items;
+    uint8_t    *ctrl;
     size_t      size;
+    size_t      tombstones;
     size_t      capacity;
 } LabelHashTable;
 
@@ -374,14 +630,21 @@ typedef struct Parser {
     LabelHashTable labels;
 } Parser;
 
+static inline Token parser_lex(Lexer *lex) {
+    if (perf_counters == NULL || !perf_counters->time_lexer) return lexer_next(lex);
+    uint64_t start = coc_now_ns();
+    Token tok = lexer_next(lex);
+    perf_counters->lex_ns += coc_now_ns() - start;
+    return tok;
+}
+
 static inline Parser *parser_init(Lexer *lex) {
     Parser *parser = (Parser *)COC_MALLOC(sizeof(Parser));
     if (parser == NULL) {
-        coc_log(COC_FATAL, "Parser init: malloc() failed");
-        exit(1);
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Parser init: malloc() failed");
     }
     parser->lex          = lex;
-    parser->cur_tok      = lexer_next(lex);
+    parser->cur_tok      = parser_lex(lex);
     parser->instructions = (Program){0};
     parser->labels       = (LabelHashTable){0};
     return parser;
@@ -393,12 +656,11 @@ static inline void parser_free(Parser *p) {
 }
 
 static inline void parser_error(const char *msg, int line) {
-    coc_log(COC_ERROR, "Syntax error at line %d: expected %s", line, msg);
-    exit(1);
+    puncta_raise(PUNCTA_ERR_SYNTAX, line, "Syntax error at line %d: expected %s", line, msg);
 }
 
 static inline void parser_next(Parser *p) {
-    p->cur_tok = lexer_next(p->lex);
+    p->cur_tok = parser_lex(p->lex);
 }
 
 static inline bool parser_accept(Parser *p, TokenKind k) {
@@ -448,6 +710,7 @@ static inline Token parser_expect(Parser *p, TokenKind k, const char *msg) {
     Instruction inst = {0};                 \
     inst.op = OP_JMP;                       \
     inst.Label = coc_str_move(&label.text); \
+    inst.target = -1;                       \
     inst.line = line;                       \
     coc_vec_append(&p->instructions, inst); \
 } while (0)
@@ -465,9 +728,26 @@ static inline Token parser_expect(Parser *p, TokenKind k, const char *msg) {
         inst.is_B_number = false;                    \
     }                                                \
     inst.Label = coc_str_move(&label.text);          \
+    inst.target = -1;                                \
     coc_vec_append(&p->instructions, inst);          \
 } while (0)
 
+#define emit_call(p, label, line) do {      \
+    Instruction inst = {0};                 \
+    inst.op = OP_CALL;                      \
+    inst.Label = coc_str_move(&label.text); \
+    inst.target = -1;                       \
+    inst.line = line;                       \
+    coc_vec_append(&p->instructions, inst); \
+} while (0)
+
+#define emit_ret(p, line) do {              \
+    Instruction inst = {0};                 \
+    inst.op = OP_RET;                       \
+    inst.line = line;                       \
+    coc_vec_append(&p->instructions, inst); \
+} while (0)
+
 #define emit_end(p) do {                   \
     Instruction end = {0};                 \
     end.op = OP_END;                       \
@@ -477,6 +757,11 @@ static inline Token parser_expect(Parser *p, TokenKind k, const char *msg) {
 
 static inline void parse_statement(Parser *p) {
     int line = p->cur_tok.line;
+    if (parser_accept(p, (TokenKind)'@')) {
+        parser_expect(p, (TokenKind)';', "';' after '@'");
+        emit_ret(p, line);
+        return;
+    }
     Token first = parser_expect(p, tok_identifier, "the first identifier");
     if (parser_accept(p, (TokenKind)':')) {
         emit_label(p, first, line);
@@ -486,6 +771,11 @@ static inline void parse_statement(Parser *p) {
         emit_jmp(p, first, line);
         return;
     }
+    if (parser_accept(p, (TokenKind)'@')) {
+        parser_expect(p, (TokenKind)';', "';' after '@'");
+        emit_call(p, first, line);
+        return;
+    }
     if (parser_accept(p, (TokenKind)'#')) {
     if (parser_accept(p, (TokenKind)':')) {
         Token end_label = first;
@@ -526,6 +816,13 @@ static inline void parse_statement(Parser *p) {
                 parser_error("identifier (action name) before '!', but got number", line);
             if (parser_accept(p, (TokenKind)'@')) {
                 Token extra = p->cur_tok;
+                // Not an assignment but a return statement after the action
+                if (extra.kind == (TokenKind)';') {
+                    parser_next(p);
+                    emit_act(p, first, second, line);
+                    emit_ret(p, line);
+                    return;
+                }
                 if (extra.kind == tok_identifier || extra.kind == tok_number) {
                     parser_next(p);
                     if (parser_accept(p, (TokenKind)'.')) {
@@ -557,7 +854,9 @@ typedef struct VarEntry {
 typedef struct VarHashTable {
     VarEntry *items;
     VarEntry *new_items;
+    uint8_t  *ctrl;
     size_t    size;
+    size_t    tombstones;
     size_t    capacity;
 } VarHashTable;
 
@@ -574,110 +873,258 @@ typedef struct ActEntry {
 typedef struct ActHashTable {
     ActEntry *items;
     ActEntry *new_items;
+    uint8_t  *ctrl;
     size_t    size;
+    size_t    tombstones;
     size_t    capacity;
 } ActHashTable;
 
-struct VM {
-    LabelHashTable labels;
-    VarHashTable   vars;
-    ActHashTable   acts;
+typedef struct Profile {
+    uint64_t *counts; // executions per instruction
+    uint64_t *cycles; // cycles spent in the action of each OP_ACT
+    uint64_t  start;  // 0 when profiling started
+    uint64_t  total;  // cycles from start to profile_stop()
+} Profile;
+
+// Counters for --metrics and for embedders. The VM thread owns the plain
+// fields and copies them to the atomic ones every METRICS_BATCH instructions
+// (and whenever run() returns), so readers on other threads never touch the
+// dispatch loop.
+#define METRICS_BATCH       65536
+#define METRICS_INTERVAL_MS 1000
+
+typedef enum MetricId {
+    METRIC_INSTRUCTIONS,
+    METRIC_JUMPS,
+    METRIC_ACTIONS,
+    METRIC_BYTES_IN,
+    METRIC_BYTES_OUT,
+    METRIC_COUNT
+} MetricId;
+
+typedef struct Metrics {
+    uint64_t           bytes_in;
+    uint64_t           bytes_out;
+    uint64_t          *calls;      // per distinct action name
+    uint32_t          *slots;      // action name of each OP_ACT instruction
+    Coc_String       **names;      // borrowed from the program
+    size_t             name_count;
+    _Atomic uint64_t   published[METRIC_COUNT];
+    _Atomic uint64_t  *published_calls;
+    atomic_bool        running;
+    atomic_bool        stop;
+    const char        *path;
+    int                interval_ms;
+    int                wake[2];    // self-pipe: SIGUSR1 and metrics_stop() wake the exporter
+    bool               has_thread;
+#ifndef _WIN32
+    pthread_t          thread;
+#endif // _WIN32
+} Metrics;
+
+#define INPUT_LINE_MAX 128
+#define CALL_STACK_MAX (1 << 20) // nested calls before a call stack overflow
+
+// A compiled program: instructions (jumps and builtin actions resolved)
+// and labels. It is never written after module_freeze(), so any number of
+// VMs on any threads can run one Module at the same time.
+typedef struct Module {
     Program        prog;
-    int            pc;
+    LabelHashTable labels;
+    Coc_Arena      arena;   // holds the module itself when compiled or loaded
+    Coc_File_Map   image;   // bytecode that the strings point into
+} Module;
+
+// The state of one execution, a single allocation next to its Module
+struct VM {
+    Module         *module;
+    VarHashTable    vars;
+    ActHashTable    acts;
+    Profile        *profile;
+    Metrics        *metrics;
+    FILE           *in;      // read by input!, getc! and gets!
+    FILE           *out;     // written by print!, putn!, putc!, puts!, putl!, putx!
+    Coc_Log_Config *log;     // NULL: the log config of the running thread
+    PunctaError     error;   // set when vm_run() fails
+    uint64_t        steps;
+    uint64_t        jumps;
+    uint64_t        check_at;    // vm->steps at which limits are checked next, UINT64_MAX: no limits
+    uint64_t        max_steps;   // 0: no instruction limit
+    uint64_t        deadline_ns; // coc_now_ns() time, 0: no timeout
+    int             timeout_ms;
+    atomic_bool    *cancel;      // NULL, or set from another thread to stop the run (vm_set_cancel)
+    int             pc;
+    int            *calls;       // return addresses of L@; statements, grown up to CALL_STACK_MAX
+    int             call_depth;
+    int             call_capacity;
+    bool            owns_module; // freed by vm_free(), as for compile_*() and bytecode_load()
+    bool            line_ready;  // line holds a whole read, only the rest of the input line is left
+    int             line_len;
+    char            line[INPUT_LINE_MAX]; // input read so far by a suspended action
 };
 
 #define vm_msg(...) do { coc_log(COC_INFO, __VA_ARGS__); } while (0)
 
-static inline VM *vm_init(Parser *p) {
+static inline Module *module_init(Parser *p) {
+    Module *m = (Module *)COC_MALLOC(sizeof(Module));
+    if (m == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Module init: malloc() failed");
+    }
+    coc_vec_move(&m->prog, &p->instructions);
+    m->labels = p->labels;
+    p->labels = (LabelHashTable){0};
+    m->arena  = (Coc_Arena){0};
+    m->image  = (Coc_File_Map){0};
+    parser_free(p);
+    return m;
+}
+
+static inline void module_free(Module *m) {
+    if (m->arena.head != NULL) {
+        // The module, its program and labels all live in the compile arena;
+        // a module loaded from bytecode also borrows strings from its image
+        Coc_Arena arena = m->arena;
+        Coc_File_Map image = m->image;
+        coc_arena_free(&arena);
+        coc_unmap_file(&image);
+        return;
+    }
+    coc_vec_free(&m->prog);
+    coc_ht_free(&m->labels);
+    COC_FREE(m);
+}
+
+// A fresh VM on m: only variables, user actions, I/O and counters are its
+// own. m must outlive it.
+static inline VM *vm_new(Module *m) {
     VM *vm = (VM *)COC_MALLOC(sizeof(VM));
     if (vm == NULL) {
-        coc_log(COC_FATAL, "VM init: malloc() failed");
-        exit(1);
-    }
-    coc_vec_move(&vm->prog, &p->instructions);
-    coc_vec_move(&vm->labels, &p->labels);
-    vm->vars = (VarHashTable){0};
-    vm->acts = (ActHashTable){0};
-    vm->pc   = 0;
-    parser_free(p);
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "VM init: malloc() failed");
+    }
+    *vm = (VM){.module = m, .in = stdin, .out = stdout, .check_at = UINT64_MAX};
     return vm;
 }
 
+static inline void metrics_stop(VM *vm);
+
 static inline void vm_free(VM *vm) {
-    coc_vec_free(&vm->prog);
-    coc_ht_free(&vm->labels);
+    if (vm->metrics != NULL) metrics_stop(vm);
     coc_ht_free(&vm->acts);
     coc_ht_free(&vm->vars);
+    COC_FREE(vm->calls);
+    if (vm->owns_module) module_free(vm->module);
     COC_FREE(vm);
 }
 
+static inline void vm_set_io(VM *vm, FILE *in, FILE *out) {
+    vm->in  = in;
+    vm->out = out;
+}
+
+typedef struct BuiltinAction {
+    const char *name;
+    size_t      len;
+    Action      act;
+} BuiltinAction;
+
+static inline const BuiltinAction *builtin_action_find(const char *name, size_t len);
+static inline Action builtin_action_at(int slot);
+
 static inline void register_act(VM *vm, const char *name, Action act) {
+    if (builtin_action_find(name, strlen(name)) != NULL) {
+        coc_log(COC_WARNING, "Action '%s' is a builtin and cannot be overridden", name);
+        return;
+    }
     Coc_String act_name = {0};
     coc_str_append(&act_name, name);
     coc_ht_insert_move(&vm->acts, &act_name, act);
 }
 
 static inline int vm_get_line_number(VM *vm) {
-    return vm->prog.items[vm->pc].line;
+    return vm->module->prog.items[vm->pc].line;
 }
 
-static inline Number *vm_get_var(VM *vm, Coc_String *var_name) {
+COC_FORCE_INLINE Number *vm_get_var(VM *vm, Coc_String *var_name) {
     Number *value = NULL;
     coc_ht_find(&vm->vars, var_name, value);
     if (value == NULL) {
-        coc_str_append_null(var_name);
-        coc_log(COC_ERROR, "Runtime error at line %d: variable '%s' not found",
-                vm_get_line_number(vm), coc_str_data(var_name));
-        exit(1);
+        puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), "Runtime error at line %d: variable '%.*s' not found",
+                vm_get_line_number(vm), (int)coc_str_size(var_name), coc_str_data(var_name));
     }
     return value;
 }
 
-static inline Action *vm_get_action(VM *vm, Coc_String *act_name) {
+static inline Action vm_get_action(VM *vm, Coc_String *act_name) {
+    const BuiltinAction *builtin = builtin_action_find(coc_str_data(act_name), coc_str_size(act_name));
+    if (builtin != NULL) return builtin->act;
     Action *act = NULL;
     coc_ht_find(&vm->acts, act_name, act);
     if (act == NULL) {
-        coc_str_append_null(act_name);
-        coc_log(COC_ERROR, "Runtime error at line %d: action '%s' not found",
-                vm_get_line_number(vm), coc_str_data(act_name));
-        exit(1);
+        puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), "Runtime error at line %d: action '%.*s' not found",
+                vm_get_line_number(vm), (int)coc_str_size(act_name), coc_str_data(act_name));
     }
-    return act;
+    return *act;
 }
 
 static inline int vm_get_label(VM *vm, Coc_String *label) {
     int *pos = NULL;
-    coc_ht_find(&vm->labels, label, pos);
+    coc_ht_find(&vm->module->labels, label, pos);
     if (pos == NULL) {
-        coc_str_append_null(label);
-        coc_log(COC_ERROR, "Runtime error at line %d: label '%s' not found",
-                vm_get_line_number(vm), coc_str_data(label));
-        exit(1);
+        puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), "Runtime error at line %d: label '%.*s' not found",
+                vm_get_line_number(vm), (int)coc_str_size(label), coc_str_data(label));
     }
     return *pos;
 }
 
-static inline void vm_assign(VM *vm, Instruction *inst) {
+COC_FORCE_INLINE void vm_assign(VM *vm, Instruction *inst) {
     Number *value = NULL;
     if (inst->is_B_number) value = &inst->number;
     else value = vm_get_var(vm, &inst->OperandB);
-    coc_ht_insert_copy(&vm->vars, &inst->OperandA, *value);
+    // Only the first assignment to a variable copies its name into the table
+    Number *slot = NULL;
+    coc_ht_find(&vm->vars, &inst->OperandA, slot);
+    if (slot != NULL) *slot = *value;
+    else coc_ht_insert_copy(&vm->vars, &inst->OperandA, *value);
     vm->pc++;
 }
 
-static inline void vm_act(VM *vm, Instruction *inst) {
+// Called once the action at pc has returned: one that raised
+// PUNCTA_WAIT_INPUT runs again on the next vm_step() and counts only then
+COC_FORCE_INLINE void vm_count_action(VM *vm, int pc) {
+    Metrics *m = vm->metrics;
+    if (COC_UNLIKELY(m != NULL)) m->calls[m->slots[pc]]++;
+}
+
+static inline void vm_count_in(VM *vm, size_t bytes) {
+    if (vm->metrics != NULL) vm->metrics->bytes_in += bytes;
+}
+
+// Takes printf()-style results, negative on error
+static inline void vm_count_out(VM *vm, int bytes) {
+    if (vm->metrics != NULL && bytes > 0) vm->metrics->bytes_out += (uint64_t)bytes;
+}
+
+// Builtins are linked by module_freeze(), only user actions are looked up
+COC_FORCE_INLINE Action vm_inst_action(VM *vm, Instruction *inst) {
+    if (COC_LIKELY(inst->target >= 0)) return builtin_action_at(inst->target);
+    return vm_get_action(vm, &inst->OperandB);
+}
+
+COC_FORCE_INLINE void vm_act(VM *vm, Instruction *inst) {
     Number *a = vm_get_var(vm, &inst->OperandA);
-    Action *act = vm_get_action(vm, &inst->OperandB);
-    (*act)(vm, a);
+    Action act = vm_inst_action(vm, inst);
+    int pc = vm->pc;
+    act(vm, a);
+    vm_count_action(vm, pc);
     vm->pc++;
 }
 
-static inline void vm_jmp(VM *vm, Instruction *inst) {
-    int pos = vm_get_label(vm, &inst->Label);
-    vm->pc = pos;
+COC_FORCE_INLINE void vm_jmp(VM *vm, Instruction *inst) {
+    if (inst->target >= 0) vm->pc = inst->target;
+    else vm->pc = vm_get_label(vm, &inst->Label);
 }
 
-static inline void vm_jeq(VM *vm, Instruction *inst) {
+COC_FORCE_INLINE bool vm_jeq_cond(VM *vm, Instruction *inst) {
     Number *a = vm_get_var(vm, &inst->OperandA);
     Number *b = NULL;
     if (inst->is_B_number) b = &inst->number;
@@ -695,42 +1142,504 @@ static inline void vm_jeq(VM *vm, Instruction *inst) {
         else
             cond = fabs((double)a->int_value - b->float_value) < eps;
     }
+    return cond;
+}
+
+COC_COLD static void vm_grow_calls(VM *vm) {
+    if (vm->call_capacity >= CALL_STACK_MAX) {
+        puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), "Runtime error at line %d: call stack overflow (%d calls deep)",
+                vm_get_line_number(vm), vm->call_depth);
+    }
+    int cap = vm->call_capacity == 0 ? 64 : vm->call_capacity * 2;
+    int *calls = (int *)COC_REALLOC(vm->calls, cap * sizeof(int));
+    if (calls == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, vm_get_line_number(vm), "Call stack: realloc() failed");
+    }
+    vm->calls         = calls;
+    vm->call_capacity = cap;
+}
+
+// The return address is the statement after the call at vm->pc
+COC_FORCE_INLINE void vm_push_return(VM *vm) {
+    if (COC_UNLIKELY(vm->call_depth == vm->call_capacity)) vm_grow_calls(vm);
+    vm->calls[vm->call_depth++] = vm->pc + 1;
+}
+
+COC_FORCE_INLINE void vm_call(VM *vm, Instruction *inst) {
+    vm_push_return(vm);
+    vm_jmp(vm, inst);
+}
+
+COC_FORCE_INLINE void vm_ret(VM *vm) {
+    if (COC_UNLIKELY(vm->call_depth == 0)) {
+        puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), "Runtime error at line %d: return without a call",
+                vm_get_line_number(vm));
+    }
+    vm->pc = vm->calls[--vm->call_depth];
+}
+
+// Returns true when the jump is taken
+COC_FORCE_INLINE bool vm_jeq(VM *vm, Instruction *inst) {
+    bool cond = vm_jeq_cond(vm, inst);
     if (cond) vm_jmp(vm, inst);
     else vm->pc++;
+    return cond;
+}
+
+COC_COLD static void metrics_publish(VM *vm) {
+    Metrics *m = vm->metrics;
+    uint64_t actions = 0;
+    for (size_t i = 0; i < m->name_count; i++) {
+        actions += m->calls[i];
+        atomic_store_explicit(&m->published_calls[i], m->calls[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&m->published[METRIC_INSTRUCTIONS], vm->steps, memory_order_relaxed);
+    atomic_store_explicit(&m->published[METRIC_JUMPS], vm->jumps, memory_order_relaxed);
+    atomic_store_explicit(&m->published[METRIC_ACTIONS], actions, memory_order_relaxed);
+    atomic_store_explicit(&m->published[METRIC_BYTES_IN], m->bytes_in, memory_order_relaxed);
+    atomic_store_explicit(&m->published[METRIC_BYTES_OUT], m->bytes_out, memory_order_relaxed);
+}
+
+// The dispatch loops count in registers and hand the counts over in batches
+COC_COLD static void vm_flush_counters(VM *vm, uint64_t steps, uint64_t jumps) {
+    vm->steps += steps;
+    vm->jumps += jumps;
+    if (vm->metrics != NULL) metrics_publish(vm);
+}
+
+// Before an action, which may snapshot the VM or read its counters: hands
+// the counts over without publishing them, batch keeps what is left of the
+// current METRICS_BATCH
+COC_FORCE_INLINE void vm_hand_over_counters(VM *vm, uint64_t *steps, uint64_t *jumps, uint64_t *batch) {
+    vm->steps += *steps;
+    vm->jumps += *jumps;
+    *batch    -= *steps;
+    *steps = *jumps = 0;
+}
+
+#define LIMIT_CLOCK_STEPS 65536 // instructions between clock reads while a timeout is set
+
+static inline void vm_limits_rearm(VM *vm, uint64_t steps) {
+    uint64_t at = UINT64_MAX;
+    if (vm->deadline_ns != 0 || vm->cancel != NULL) at = steps + LIMIT_CLOCK_STEPS;
+    if (vm->max_steps != 0 && vm->max_steps < at) at = vm->max_steps;
+    vm->check_at = at;
+}
+
+// Stops vm once it has run max_instructions more instructions or for
+// timeout_ms from now (0: no limit). Limits are only checked at backward
+// jumps and actions, where a program can loop, so straight-line code and
+// the loop bodies pay nothing but one compare per iteration.
+static inline void vm_set_limits(VM *vm, uint64_t max_instructions, int timeout_ms) {
+    vm->max_steps   = max_instructions > 0 ? vm->steps + max_instructions : 0;
+    vm->deadline_ns = timeout_ms > 0 ? coc_now_ns() + (uint64_t)timeout_ms * 1000000 : 0;
+    vm->timeout_ms  = timeout_ms;
+    vm_limits_rearm(vm, vm->steps);
+}
+
+// Lets another thread stop vm by setting *cancel: the run then fails with
+// PUNCTA_ERR_LIMIT at its next limit check, as for a timeout. The flag is
+// polled with the clock, every LIMIT_CLOCK_STEPS instructions at backward
+// jumps and actions, and when an input action reaches the end of its
+// input. A read blocked in vm->in is not interrupted: run_serve() feeds
+// its VMs through a pipe it closes on a cancel.
+static inline void vm_set_cancel(VM *vm, atomic_bool *cancel) {
+    vm->cancel = cancel;
+    vm_limits_rearm(vm, vm->steps);
+}
+
+// Nearest label at or before pc, NULL before the first one
+COC_COLD static Coc_String *vm_label_before(VM *vm, int pc) {
+    Coc_String *label = NULL;
+    int best = -1;
+    for (size_t i = 0; i < vm->module->labels.capacity; i++) {
+        LabelEntry *e = &vm->module->labels.items[i];
+        if (!e->is_used || e->value > pc || e->value <= best) continue;
+        best  = e->value;
+        label = &e->key;
+    }
+    return label;
+}
+
+COC_COLD static void vm_limits_reached(VM *vm, uint64_t steps) {
+    bool out_of_steps = vm->max_steps != 0 && steps >= vm->max_steps;
+    bool out_of_time  = vm->deadline_ns != 0 && coc_now_ns() >= vm->deadline_ns;
+    bool cancelled    = vm->cancel != NULL && atomic_load_explicit(vm->cancel, memory_order_relaxed);
+    if (!out_of_steps && !out_of_time && !cancelled) {
+        vm_limits_rearm(vm, steps);
+        return;
+    }
+    int line = vm_get_line_number(vm);
+    Coc_String *label = vm_label_before(vm, vm->pc);
+    char where[64] = "";
+    if (label != NULL) snprintf(where, sizeof(where), " (in '%.*s')", (int)coc_str_size(label), coc_str_data(label));
+    if (out_of_steps) {
+        puncta_raise(PUNCTA_ERR_LIMIT, line, "Limit error at line %d%s: instruction limit reached after %llu instructions",
+                     line, where, (unsigned long long)steps);
+    }
+    if (cancelled) {
+        puncta_raise(PUNCTA_ERR_LIMIT, line, "Limit error at line %d%s: cancelled after %llu instructions",
+                     line, where, (unsigned long long)steps);
+    }
+    puncta_raise(PUNCTA_ERR_LIMIT, line, "Limit error at line %d%s: timeout of %d ms reached",
+                 line, where, vm->timeout_ms);
+}
+
+COC_FORCE_INLINE void vm_check_limits(VM *vm, uint64_t steps) {
+    if (COC_UNLIKELY(vm->steps + steps >= vm->check_at)) vm_limits_reached(vm, vm->steps + steps);
+}
+
+// Called after a jump from pc: only backward jumps can form loops
+COC_FORCE_INLINE void vm_check_loop(VM *vm, int pc, uint64_t steps) {
+    if (vm->pc <= pc) vm_check_limits(vm, steps);
 }
 
 void run(VM *vm) {
-    int n = vm->prog.size;
+    uint64_t steps = 0, jumps = 0, batch = METRICS_BATCH;
+    // The module is read-only, so its program can live in registers
+    Instruction *code = vm->module->prog.items;
+    int n = vm->module->prog.size;
+    while (vm->pc < n) {
+        int pc = vm->pc;
+        Instruction *inst = &code[pc];
+        switch (inst->op) {
+        case OP_ASSIGN: vm_assign(vm, inst); break;
+        case OP_ACT:
+            vm_check_limits(vm, steps);
+            vm_hand_over_counters(vm, &steps, &jumps, &batch);
+            vm_act(vm, inst);
+            break;
+        case OP_JEQ:
+            if (vm_jeq(vm, inst)) {
+                jumps++;
+                vm_check_loop(vm, pc, steps);
+            }
+            break;
+        case OP_JMP:
+            vm_jmp(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_CALL:
+            vm_call(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_RET:
+            vm_ret(vm);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_END:    vm->pc++; break;
+        }
+        if (COC_UNLIKELY(++steps == batch)) {
+            vm_flush_counters(vm, steps, jumps);
+            steps = jumps = 0;
+            batch = METRICS_BATCH;
+        }
+    }
+    vm_flush_counters(vm, steps, jumps);
+}
+
+// run() for at most budget instructions, returns true when the program
+// ended. Counters are flushed before each action, which may suspend the VM.
+static inline bool run_steps(VM *vm, uint64_t budget) {
+    uint64_t steps = 0, jumps = 0;
+    Instruction *code = vm->module->prog.items;
+    int n = vm->module->prog.size;
+    for (; vm->pc < n && budget > 0; budget--) {
+        int pc = vm->pc;
+        Instruction *inst = &code[pc];
+        switch (inst->op) {
+        case OP_ASSIGN: vm_assign(vm, inst); break;
+        case OP_ACT:
+            vm_flush_counters(vm, steps, jumps);
+            steps = jumps = 0;
+            vm_check_limits(vm, 0);
+            vm_act(vm, inst);
+            break;
+        case OP_JEQ:
+            if (vm_jeq(vm, inst)) {
+                jumps++;
+                vm_check_loop(vm, pc, steps);
+            }
+            break;
+        case OP_JMP:
+            vm_jmp(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_CALL:
+            vm_call(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_RET:
+            vm_ret(vm);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_END:    vm->pc++; break;
+        }
+        if (COC_UNLIKELY(++steps == METRICS_BATCH)) {
+            vm_flush_counters(vm, steps, jumps);
+            steps = jumps = 0;
+        }
+    }
+    vm_flush_counters(vm, steps, jumps);
+    return vm->pc >= n;
+}
+
+// Same dispatch as run(), plus counters. Kept separate so that run()
+// does not pay for profiling when it is off.
+COC_COLD static void run_profiled(VM *vm) {
+    Profile *prof = vm->profile;
+    uint64_t steps = 0, jumps = 0, batch = METRICS_BATCH;
+    Instruction *code = vm->module->prog.items;
+    int n = vm->module->prog.size;
     while (vm->pc < n) {
-        Instruction *inst = &vm->prog.items[vm->pc];
+        int pc = vm->pc;
+        Instruction *inst = &code[pc];
+        prof->counts[pc]++;
         switch (inst->op) {
         case OP_ASSIGN: vm_assign(vm, inst); break;
-        case OP_ACT:    vm_act(vm, inst)   ; break;
-        case OP_JEQ:    vm_jeq(vm, inst)   ; break;
-        case OP_JMP:    vm_jmp(vm, inst)   ; break;
-        case OP_END:    vm->pc++           ; break;
+        case OP_ACT: {
+            vm_check_limits(vm, steps);
+            vm_hand_over_counters(vm, &steps, &jumps, &batch);
+            Number *a = vm_get_var(vm, &inst->OperandA);
+            Action act = vm_inst_action(vm, inst);
+            uint64_t t0 = coc_cycles();
+            act(vm, a);
+            // Inclusive: labels called back from the action are counted too
+            prof->cycles[pc] += coc_cycles() - t0;
+            vm_count_action(vm, pc);
+            vm->pc++;
+            break;
+        }
+        case OP_JEQ:
+            if (vm_jeq(vm, inst)) {
+                jumps++;
+                vm_check_loop(vm, pc, steps);
+            }
+            break;
+        case OP_JMP:
+            vm_jmp(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_CALL:
+            vm_call(vm, inst);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_RET:
+            vm_ret(vm);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_END:    vm->pc++; break;
+        }
+        if (++steps == batch) {
+            vm_flush_counters(vm, steps, jumps);
+            steps = jumps = 0;
+            batch = METRICS_BATCH;
         }
     }
+    vm_flush_counters(vm, steps, jumps);
 }
 
 static inline void vm_call_label(VM *vm, Coc_String *label) {
     vm->pc = vm_get_label(vm, label);
-    run(vm);
+    if (vm->profile != NULL) run_profiled(vm);
+    else run(vm);
+}
+
+// Messages of this VM go to config while it runs (NULL: the thread's own)
+static inline void vm_set_log(VM *vm, Coc_Log_Config *config) {
+    vm->log = config;
+}
+
+// Runs the program on the calling thread until it ends or fails. Each VM
+// only touches its own state, so separate VMs can run on separate threads
+// at the same time. A failure stops this VM alone: its status is returned
+// and the details are kept in vm->error.
+static inline PunctaStatus vm_run(VM *vm) {
+    Coc_Log_Config *prev_log = coc_log_use(vm->log != NULL ? vm->log : coc_thread_log_config);
+    vm->error = (PunctaError){0};
+    PunctaTrap trap;
+    puncta_trap_push(&trap, &vm->error);
+    if (setjmp(trap.env) != 0) {
+        coc_log_use(prev_log);
+        return vm->error.status;
+    }
+    if (vm->profile != NULL) run_profiled(vm);
+    else run(vm);
+    puncta_trap_pop(&trap);
+    coc_log_use(prev_log);
+    return PUNCTA_OK;
+}
+
+typedef enum VmStepStatus {
+    VM_STEP_FINISHED,
+    VM_STEP_BUDGET,     // budget instructions ran, the program goes on
+    VM_STEP_WAIT_INPUT, // an input action found no data on a non-blocking vm->in
+    VM_STEP_ERROR       // details in vm->error
+} VmStepStatus;
+
+// Runs at most budget instructions and returns why it stopped. The next
+// call resumes where this one left off; an input action that had to wait
+// runs again, keeping what it has read. A host loop can thus share a few
+// threads among many VMs with non-blocking input. Profiling is ignored and
+// a label called by vm_call_label() runs to its end.
+static inline VmStepStatus vm_step(VM *vm, uint64_t budget) {
+    Coc_Log_Config *prev_log = coc_log_use(vm->log != NULL ? vm->log : coc_thread_log_config);
+    vm->error = (PunctaError){0};
+    PunctaTrap trap;
+    puncta_trap_push(&trap, &vm->error);
+    if (setjmp(trap.env) != 0) {
+        coc_log_use(prev_log);
+        return vm->error.status == PUNCTA_WAIT_INPUT ? VM_STEP_WAIT_INPUT : VM_STEP_ERROR;
+    }
+    bool finished = run_steps(vm, budget);
+    puncta_trap_pop(&trap);
+    coc_log_use(prev_log);
+    return finished ? VM_STEP_FINISHED : VM_STEP_BUDGET;
+}
+
+// The mutable state of a VM: variable and user action tables copied slot
+// for slot, pc, counters and streams. Profiles, metrics and the cancel flag are
+// not kept.
+typedef struct VmSnapshot {
+    Module         *module;
+    VarHashTable    vars;
+    ActHashTable    acts;
+    FILE           *in;
+    FILE           *out;
+    Coc_Log_Config *log;
+    int64_t         in_pos;      // offset of in, -1 when it cannot seek (pipe, terminal)
+    uint64_t        steps;
+    uint64_t        jumps;
+    uint64_t        max_steps;
+    int             timeout_ms;
+    int             pc;
+    int            *calls;
+    int             call_depth;
+    bool            line_ready;
+    int             line_len;
+    char            line[INPUT_LINE_MAX];
+} VmSnapshot;
+
+static inline int64_t vm_stream_tell(FILE *fp) {
+#ifdef _WIN32
+    return _ftelli64(fp);
+#else
+    return (int64_t)ftello(fp);
+#endif // _WIN32
+}
+
+static inline int vm_stream_seek(FILE *fp, int64_t pos) {
+#ifdef _WIN32
+    return _fseeki64(fp, pos, SEEK_SET);
+#else
+    return fseeko(fp, (off_t)pos, SEEK_SET);
+#endif // _WIN32
+}
+
+// Captures vm, e.g. after it ran an initialization prefix. Taken from an
+// action while vm runs, clones resume after that action. The module must
+// outlive the snapshot.
+// Clones share the in and out streams; a seekable input is put back at the
+// snapshot's offset by every vm_clone(), so clones reading it should run
+// one after another. A pipe cannot be rewound and is shared as it is.
+// The instruction limit carries over; a timeout restarts when the clone is
+// made, since the snapshot's deadline may long have passed.
+static inline VmSnapshot *vm_snapshot(VM *vm) {
+    VmSnapshot *snap = (VmSnapshot *)COC_MALLOC(sizeof(VmSnapshot));
+    if (snap == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "VM snapshot: malloc() failed");
+    }
+    bool running = puncta_trap != NULL && puncta_trap->error == &vm->error;
+    *snap = (VmSnapshot){
+        .module = vm->module,
+        .in     = vm->in,
+        .out    = vm->out,
+        .log        = vm->log,
+        .in_pos     = vm->in != NULL ? vm_stream_tell(vm->in) : -1,
+        .steps      = vm->steps,
+        .jumps      = vm->jumps,
+        .max_steps  = vm->max_steps,
+        .timeout_ms = vm->timeout_ms,
+        .pc         = running ? vm->pc + 1 : vm->pc,
+        .line_ready = vm->line_ready,
+        .line_len   = vm->line_len
+    };
+    memcpy(snap->line, vm->line, (size_t)vm->line_len);
+    coc_ht_copy(&snap->vars, &vm->vars);
+    coc_ht_copy(&snap->acts, &vm->acts);
+    if (vm->call_depth > 0) {
+        snap->calls = (int *)COC_MALLOC(vm->call_depth * sizeof(int));
+        if (snap->calls == NULL) {
+            puncta_raise(PUNCTA_ERR_MEMORY, 0, "VM snapshot: malloc() failed");
+        }
+        memcpy(snap->calls, vm->calls, vm->call_depth * sizeof(int));
+        snap->call_depth = vm->call_depth;
+    }
+    return snap;
+}
+
+// A new VM in the state of snap, ready for vm_run(). Cloning copies the
+// table slots flat, so it costs about as much as a memcpy of the variables.
+static inline VM *vm_clone(const VmSnapshot *snap) {
+    VM *vm = vm_new(snap->module);
+    coc_ht_copy(&vm->vars, &snap->vars);
+    coc_ht_copy(&vm->acts, &snap->acts);
+    vm->in         = snap->in;
+    vm->out        = snap->out;
+    vm->log        = snap->log;
+    vm->steps      = snap->steps;
+    vm->jumps      = snap->jumps;
+    vm->pc         = snap->pc;
+    vm->line_ready = snap->line_ready;
+    vm->line_len   = snap->line_len;
+    memcpy(vm->line, snap->line, (size_t)snap->line_len);
+    if (snap->in_pos >= 0 && vm_stream_seek(vm->in, snap->in_pos) != 0) {
+        puncta_raise(PUNCTA_ERR_IO, 0, "VM clone: cannot seek input: %s", strerror(errno));
+    }
+    vm->max_steps   = snap->max_steps;
+    vm->timeout_ms  = snap->timeout_ms;
+    vm->deadline_ns = snap->timeout_ms > 0 ? coc_now_ns() + (uint64_t)snap->timeout_ms * 1000000 : 0;
+    vm_limits_rearm(vm, vm->steps);
+    if (snap->call_depth > 0) {
+        vm->calls = (int *)COC_MALLOC(snap->call_depth * sizeof(int));
+        if (vm->calls == NULL) {
+            puncta_raise(PUNCTA_ERR_MEMORY, 0, "VM clone: malloc() failed");
+        }
+        memcpy(vm->calls, snap->calls, snap->call_depth * sizeof(int));
+        vm->call_depth    = snap->call_depth;
+        vm->call_capacity = snap->call_depth;
+    }
+    return vm;
+}
+
+static inline void vm_snapshot_free(VmSnapshot *snap) {
+    coc_ht_free(&snap->vars);
+    coc_ht_free(&snap->acts);
+    COC_FREE(snap->calls);
+    COC_FREE(snap);
 }
 
-static inline void vm_check_labels(VM *vm) {
-    for (size_t i = 0; i < vm->prog.size; i++) {
-        Instruction *inst = &vm->prog.items[i];
-        if (inst->op != OP_JMP && inst->op != OP_JEQ) continue;
+static inline void module_check_labels(Module *m) {
+    for (size_t i = 0; i < m->prog.size; i++) {
+        Instruction *inst = &m->prog.items[i];
+        if (inst->op != OP_JMP && inst->op != OP_JEQ && inst->op != OP_CALL) continue;
         int *pos = NULL;
-        coc_ht_find(&vm->labels, &inst->Label, pos);
+        coc_ht_find(&m->labels, &inst->Label, pos);
         if (pos == NULL) {
-            coc_str_append_null(&inst->Label);
-            coc_log(COC_ERROR,
-                    "Semantic error at line %d: label '%s' not defined",
-                    inst->line, coc_str_data(&inst->Label));
-            exit(1);
+            puncta_raise(PUNCTA_ERR_SEMANTIC, inst->line,
+                    "Semantic error at line %d: label '%.*s' not defined",
+                    inst->line, (int)coc_str_size(&inst->Label), coc_str_data(&inst->Label));
         }
+        inst->target = *pos;
     }
 }
 
@@ -793,10 +1702,9 @@ static inline void act_isneg(VM *vm, Number *n) {
     long long result;
     if (n->is_float) {
         if (isnan(n->float_value)) {
-            coc_log(COC_ERROR, 
+            puncta_raise(PUNCTA_ERR_RUNTIME, vm_get_line_number(vm), 
                     "Runtime error at line %d: isneg expects a number (got NaN)",
                     vm_get_line_number(vm));
-            exit(1);
         }
         result = (n->float_value < 0.0);
     } else {
@@ -812,13 +1720,49 @@ static inline void act_toint(VM *vm, Number *n) {
     n->is_float = false;
 }
 
+static inline bool vm_input_would_block(VM *vm) {
+    if (!ferror(vm->in) || (errno != EAGAIN && errno != EWOULDBLOCK)) return false;
+    clearerr(vm->in);
+    return true;
+}
+
+// Reads like fgets() into vm->line, at most size - 1 bytes. Bytes read
+// before a non-blocking vm->in runs dry stay in vm->line while the VM
+// waits. Returns false at the end of input with nothing read; a cancelled
+// VM (vm_set_cancel()) fails there instead, its input may have been cut.
+static inline bool vm_read_line(VM *vm, size_t size) {
+    COC_ASSERT(size <= INPUT_LINE_MAX);
+    while (!vm->line_ready) {
+        char *at = vm->line + vm->line_len;
+        if (fgets(at, (int)(size - vm->line_len), vm->in) != NULL) {
+            size_t len = strlen(at);
+            vm_count_in(vm, len);
+            vm->line_len += (int)len;
+            if (vm->line[vm->line_len - 1] == '\n' || (size_t)vm->line_len == size - 1) break;
+        }
+        if (vm_input_would_block(vm)) puncta_wait_input(vm_get_line_number(vm));
+        if (vm->cancel != NULL && atomic_load(vm->cancel)) vm_limits_reached(vm, vm->steps);
+        if (vm->line_len == 0) return false;
+        break;
+    }
+    vm->line_ready = true;
+    return true;
+}
+
+// Hands the line read by vm_read_line() to buf and gets ready for the next
+static inline void vm_take_line(VM *vm, char *buf) {
+    memcpy(buf, vm->line, vm->line_len);
+    buf[vm->line_len] = '\0';
+    vm->line_len   = 0;
+    vm->line_ready = false;
+}
+
 static inline void act_input(VM *vm, Number *n) {
-    COC_UNUSED(vm);
-    char buf[128];
-    if (!fgets(buf, sizeof(buf), stdin)) {
-        coc_log(COC_FATAL, "Input error: fgets() failed");
-        exit(1);
+    char buf[INPUT_LINE_MAX];
+    if (!vm_read_line(vm, sizeof(buf))) {
+        puncta_raise(PUNCTA_ERR_IO, vm_get_line_number(vm), "Input error: fgets() failed");
     }
+    vm_take_line(vm, buf);
     bool is_float = false;
     bool is_hex = false;
     if (buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X')) is_hex = true;
@@ -833,38 +1777,32 @@ static inline void act_input(VM *vm, Number *n) {
     if (is_float) {
         double f = strtod(buf, &end_ptr);
         if (end_ptr == buf) {
-            coc_log(COC_ERROR, "Input error: invalid floating-point literal");
-            exit(1);
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm), "Input error: invalid floating-point literal");
         }
         if (*end_ptr != '\0' && *end_ptr != '\r' && *end_ptr != '\n') {
-            coc_log(COC_ERROR, "Input error: invalid character '%c' in floating-point literal", *end_ptr);
-            exit(1);
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm), "Input error: invalid character '%c' in floating-point literal", *end_ptr);
         }
         if (errno == ERANGE) {
-            coc_log(COC_ERROR, "Input error : floating-point literal out of range");
-            exit(errno);
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm), "Input error : floating-point literal out of range");
         }
         n->float_value = f;
         n->is_float = true;
     } else {
         long long v = strtoll(buf, &end_ptr, is_hex ? 16 : 10);
         if (end_ptr == buf) {
-            coc_log(COC_ERROR,
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm),
                     "Input error: invalid %s integer literal",
                     is_hex ? "hexadecimal" : "decimal");
-            exit(1);
         }
         if (*end_ptr != '\0' && *end_ptr != '\r' && *end_ptr != '\n') {
-            coc_log(COC_ERROR,
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm),
                     "Input error: invalid character '%c' in %s integer literal",
                     *end_ptr, is_hex ? "hexadecimal" : "decimal");
-            exit(1);
         }
         if (errno == ERANGE) {
-            coc_log(COC_ERROR,
+            puncta_raise(PUNCTA_ERR_INPUT, vm_get_line_number(vm),
                     "Input error : %s integer literal out of range",
                     is_hex ? "hexadecimal" : "decimal");
-            exit(errno);
         }
         n->int_value = v;
         n->is_float = false;
@@ -872,41 +1810,43 @@ static inline void act_input(VM *vm, Number *n) {
 }
 
 static inline void act_print(VM *vm, Number *n) {
-    COC_UNUSED(vm);
-    if (n->is_float) printf("%g\n", n->float_value);
-    else printf("%lld\n", n->int_value);
+    if (n->is_float) vm_count_out(vm, fprintf(vm->out, "%g\n", n->float_value));
+    else vm_count_out(vm, fprintf(vm->out, "%lld\n", n->int_value));
 }
 
 static inline void act_putn(VM *vm, Number *n) {
-    COC_UNUSED(vm);
-    if (n->is_float) printf("%g", n->float_value);
-    else printf("%lld", n->int_value);
+    if (n->is_float) vm_count_out(vm, fprintf(vm->out, "%g", n->float_value));
+    else vm_count_out(vm, fprintf(vm->out, "%lld", n->int_value));
 }
 
+// The rest of the line is skipped, the character waits in vm->line meanwhile
 static inline void act_getc(VM *vm, Number *n) {
-    COC_UNUSED(vm);
-    int c = getchar();
-    if (c == EOF) {
-        coc_log(COC_FATAL, "Input error: getchar() failed");
-        exit(1);
-    } 
+    if (!vm_read_line(vm, 2)) {
+        puncta_raise(PUNCTA_ERR_IO, vm_get_line_number(vm), "Input error: getchar() failed");
+    }
+    int c = (unsigned char)vm->line[0];
+    int rest;
+    size_t bytes = 0;
+    while ((rest = getc(vm->in)) != '\n' && rest != EOF) bytes++;
+    vm_count_in(vm, bytes + (rest == '\n'));
+    if (rest == EOF && vm_input_would_block(vm)) puncta_wait_input(vm_get_line_number(vm));
+    vm->line_len   = 0;
+    vm->line_ready = false;
     n->int_value = c;
     n->is_float = false;
-    while ((c = getchar()) != '\n' && c != EOF);
 }
 
 static inline void act_putc(VM *vm, Number *n) {
     int value = number_trunc_i64(n, "putc", vm_get_line_number(vm));
-    putchar(value);
+    if (putc(value, vm->out) != EOF) vm_count_out(vm, 1);
 }
 
 static inline void act_gets(VM *vm, Number *n) {
-    COC_UNUSED(vm);
     char buf[32];
-    if (!fgets(buf, sizeof(buf), stdin)) {
-        coc_log(COC_FATAL, "Input error: fgets() failed");
-        exit(1);
+    if (!vm_read_line(vm, sizeof(buf))) {
+        puncta_raise(PUNCTA_ERR_IO, vm_get_line_number(vm), "Input error: fgets() failed");
     }
+    vm_take_line(vm, buf);
     uint64_t value = 0;
     bool is_extra = false;
     size_t len = 0;
@@ -922,18 +1862,18 @@ static inline void act_gets(VM *vm, Number *n) {
 static inline void act_puts(VM *vm, Number *n) {
     char buf[16];
     number_to_string(n, buf, sizeof(buf), "puts", vm_get_line_number(vm));
-    printf("%s", buf);
+    vm_count_out(vm, fprintf(vm->out, "%s", buf));
 }
 
 static inline void act_putl(VM *vm, Number *n) {
     char buf[16];
-    number_to_string(n, buf, sizeof(buf), "putl", vm_get_line_number(vm));
-    puts(buf);
+    size_t len = number_to_string(n, buf, sizeof(buf), "putl", vm_get_line_number(vm));
+    if (fputs(buf, vm->out) != EOF && putc('\n', vm->out) != EOF) vm_count_out(vm, (int)len + 1);
 }
 
 static inline void act_putx(VM *vm, Number *n) {
     uint64_t value = (uint64_t)number_trunc_i64(n, "putx", vm_get_line_number(vm));
-    printf("%016llx", value);
+    vm_count_out(vm, fprintf(vm->out, "%016llx", value));
 }
 
 static inline void act_eval(VM *vm, Number *n) {
@@ -956,56 +1896,2864 @@ static inline void act_eval(VM *vm, Number *n) {
     n->is_float = true;
 }
 
-static inline void register_builtin_actions(VM *vm) {
-    int start = __LINE__;
-    register_act(vm, "inc"   , act_inc);
-    register_act(vm, "dec"   , act_dec);
-    register_act(vm, "double", act_double);
-    register_act(vm, "halve" , act_halve);
-    register_act(vm, "neg"   , act_neg);
-    register_act(vm, "abs"   , act_abs);
-    register_act(vm, "not"   , act_not);
-    register_act(vm, "isodd" , act_isodd);
-    register_act(vm, "isneg" , act_isneg);
-    register_act(vm, "input" , act_input);
-    register_act(vm, "toint" , act_toint);
-    register_act(vm, "print" , act_print);
-    register_act(vm, "putn"  , act_putn);
-    register_act(vm, "getc"  , act_getc);
-    register_act(vm, "putc"  , act_putc);
-    register_act(vm, "gets"  , act_gets);
-    register_act(vm, "puts"  , act_puts);
-    register_act(vm, "putl"  , act_putl);
-    register_act(vm, "putx"  , act_putx);
-    register_act(vm, "eval"  , act_eval);
-    int end = __LINE__;
-    coc_log(COC_DEBUG, "Register %d builtin actions", end - start + 1);
+// Builtin actions live in a static perfect hash keyed by the first, third
+// and last character and the length of the name (all builtins have at least
+// 3 characters). The multipliers were found by exhaustive search; a colliding
+// entry is reported by -Woverride-init when the table is compiled.
+#define BUILTIN_ACT_CAP     32
+#define BUILTIN_ACT_MIN_LEN 3
+
+#define BUILTIN_ACT_SLOT(c0, c2, cn, len) \
+    (((size_t)(c0) + (size_t)(c2) * 22 + (size_t)(cn) * 25 + (size_t)(len)) & (BUILTIN_ACT_CAP - 1))
+
+#define BUILTIN_ACT(name, c0, c2, cn) \
+    [BUILTIN_ACT_SLOT(c0, c2, cn, sizeof(#name) - 1)] = {#name, sizeof(#name) - 1, act_##name}
+
+static const BuiltinAction builtin_actions[BUILTIN_ACT_CAP] = {
+    BUILTIN_ACT(inc   , 'i', 'c', 'c'),
+    BUILTIN_ACT(dec   , 'd', 'c', 'c'),
+    BUILTIN_ACT(double, 'd', 'u', 'e'),
+    BUILTIN_ACT(halve , 'h', 'l', 'e'),
+    BUILTIN_ACT(neg   , 'n', 'g', 'g'),
+    BUILTIN_ACT(abs   , 'a', 's', 's'),
+    BUILTIN_ACT(not   , 'n', 't', 't'),
+    BUILTIN_ACT(isodd , 'i', 'o', 'd'),
+    BUILTIN_ACT(isneg , 'i', 'n', 'g'),
+    BUILTIN_ACT(input , 'i', 'p', 't'),
+    BUILTIN_ACT(toint , 't', 'i', 't'),
+    BUILTIN_ACT(print , 'p', 'i', 't'),
+    BUILTIN_ACT(putn  , 'p', 't', 'n'),
+    BUILTIN_ACT(getc  , 'g', 't', 'c'),
+    BUILTIN_ACT(putc  , 'p', 't', 'c'),
+    BUILTIN_ACT(gets  , 'g', 't', 's'),
+    BUILTIN_ACT(puts  , 'p', 't', 's'),
+    BUILTIN_ACT(putl  , 'p', 't', 'l'),
+    BUILTIN_ACT(putx  , 'p', 't', 'x'),
+    BUILTIN_ACT(eval  , 'e', 'a', 'l'),
+};
+
+static inline const BuiltinAction *builtin_action_find(const char *name, size_t len) {
+    if (len < BUILTIN_ACT_MIN_LEN) return NULL;
+    const unsigned char *s = (const unsigned char *)name;
+    const BuiltinAction *b = &builtin_actions[BUILTIN_ACT_SLOT(s[0], s[2], s[len - 1], len)];
+    if (b->len == len && memcmp(b->name, name, len) == 0) return b;
+    return NULL;
+}
+
+static inline Action builtin_action_at(int slot) {
+    return builtin_actions[slot].act;
 }
 
-static inline VM *run_file(const char *filename, void (*register_user_actions)(VM *)) {
-    Coc_String source = {0};
-    if (coc_read_entire_file(filename, &source) != 0) return NULL;
-    Lexer *lex = lexer_init(source);
-    Parser *parser = parser_init(lex);
-    parse_program(parser);
-    coc_log(COC_DEBUG,
-        "Compile finished: %zu instructions, %zu labels",
-        parser->instructions.size, parser->labels.size);
-    VM *vm = vm_init(parser);
-    register_builtin_actions(vm);
-    if (register_user_actions != NULL) {
-        coc_log(COC_DEBUG, "Register user actions");
-        register_user_actions(vm);
-    }
-    vm_check_labels(vm);
-    run(vm);
-    return vm;
+// Links builtin actions into target and hashes every identifier up front,
+// from instruction from on. Lookups cache the hash in their key, so after
+// this the module is only read while it runs.
+static inline void module_freeze_from(Module *m, size_t from) {
+    for (size_t i = from; i < m->prog.size; i++) {
+        Instruction *inst = &m->prog.items[i];
+        if (inst->op == OP_ACT) {
+            const BuiltinAction *b = builtin_action_find(coc_str_data(&inst->OperandB), coc_str_size(&inst->OperandB));
+            inst->target = b != NULL ? (int)(b - builtin_actions) : -1;
+        }
+        if (coc_str_size(&inst->OperandA) > 0) coc_hash_value(&inst->OperandA);
+        if (coc_str_size(&inst->OperandB) > 0) coc_hash_value(&inst->OperandB);
+        if (coc_str_size(&inst->Label) > 0) coc_hash_value(&inst->Label);
+    }
 }
 
-#endif // PUNCTA_H_
+static inline void module_freeze(Module *m) {
+    module_freeze_from(m, 0);
+}
 
-/*
-Recent Revision History:
+#define PARSE_CHUNK_MIN ((size_t)1 << 20) // smallest slice of a source parsed on a thread of its own
+
+// Threads compile_source() parses a large source on, 0: one per CPU
+static int compile_jobs = 0;
+
+typedef struct LabelList {
+    LabelEntry *items;
+    size_t      size;
+    size_t      capacity;
+} LabelList;
+
+typedef struct ParseChunk {
+    Coc_String  src;    // a view into the source
+    int         line;   // line number of its first byte
+    Program     prog;   // without OP_END
+    LabelList   labels; // positions relative to the chunk
+    Coc_Arena   arena;
+    PunctaError error;
+} ParseChunk;
+
+// Cuts src into at most max slices of about equal size. Each one starts a
+// statement: it follows a '.', '!', ';' or ':' outside strings and comments
+// and begins with an identifier, so an action is never split from its '@'.
+// Only string and comment state is tracked on the way, which is enough to
+// know where the lexer would be. Returns the number of slices and where
+// each starts, in bytes and in lines.
+static inline int parse_split(const char *src, size_t size, int max, size_t *starts, int *lines) {
+    size_t step = size / max;
+    int count = 1;
+    starts[0] = 0;
+    lines[0]  = 1;
+    int line = 1, depth = 0;
+    bool in_string = false;
+    for (size_t i = 0; i < size && count < max; i++) {
+        char c = src[i];
+        if (c == '\n') {
+            line++;
+            in_string = false; // a lexical error, reported by the slice holding it
+            continue;
+        }
+        if (in_string) {
+            if (c == '\\') i++;
+            else if (c == '"') in_string = false;
+            continue;
+        }
+        if (depth > 0) {
+            if (c == '(') depth++;
+            else if (c == ')') depth--;
+            continue;
+        }
+        if (c == '"') in_string = true;
+        else if (c == '(') depth = 1;
+        else if ((c == '.' || c == '!' || c == ';' || c == ':') && i + 1 >= step * count) {
+            size_t j = i + 1;
+            while (j < size && isspace((unsigned char)src[j])) j++;
+            if (j < size && (isalpha((unsigned char)src[j]) || src[j] == '_')) {
+                starts[count] = i + 1;
+                lines[count]  = line;
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+#ifndef _WIN32
+static void *parse_chunk_main(void *arg) {
+    ParseChunk *c = (ParseChunk *)arg;
+    // Only the first failing chunk is reported, by parse_parallel()
+    Coc_Log_Config quiet = *coc_log_current();
+    quiet.min_level = COC_NONE;
+    Coc_Log_Config *prev_log = coc_log_use(&quiet);
+    Coc_Arena *prev_arena = coc_arena_begin(&c->arena);
+    PunctaTrap trap;
+    puncta_trap_push(&trap, &c->error);
+    if (setjmp(trap.env) == 0) {
+        // Never freed by parser_free(): the source is only borrowed
+        Lexer *lex = lexer_init(c->src);
+        lex->line = c->line;
+        Parser *parser = parser_init(lex);
+        while (parser->cur_tok.kind != tok_eof) parse_statement(parser);
+        c->prog = parser->instructions;
+        // Only the entries are needed for the merge: pack them to the front
+        // and shrink, which halves what waits for it
+        LabelHashTable *t = &parser->labels;
+        size_t n = 0;
+        for (size_t i = 0; i < t->capacity; i++)
+            if (t->items[i].is_used) t->items[n++] = t->items[i];
+        COC_FREE(t->ctrl);
+        c->labels.items = n > 0 ? (LabelEntry *)COC_REALLOC(t->items, n * sizeof(LabelEntry)) : t->items;
+        c->labels.size = c->labels.capacity = n;
+        puncta_trap_pop(&trap);
+    }
+    coc_arena_end(prev_arena);
+    coc_log_use(prev_log);
+    return NULL;
+}
+
+#endif // _WIN32
+
+// Parses a large source in slices on compile_jobs threads, each into its
+// own program, labels and arena. The programs are then concatenated with
+// their labels moved by the instructions before them; a label defined in
+// several slices keeps its last position, as in a single pass. Errors are
+// those of the first failing slice, which are the ones a single pass would
+// raise. Returns NULL when source is too small to split (or on Windows),
+// otherwise a module in the active arena, and then frees source like
+// module_init().
+static inline Module *parse_parallel(Coc_String *source) {
+#ifndef _WIN32
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int jobs = compile_jobs > 0 ? compile_jobs : (cpus > 0 ? (int)cpus : 1);
+    const char *src = coc_str_data(source);
+    size_t size = coc_str_size(source);
+    // The lexer stops at a NUL byte
+    const char *nul = (const char *)memchr(src, '\0', size);
+    if (nul != NULL) size = (size_t)(nul - src);
+    if ((size_t)jobs > size / PARSE_CHUNK_MIN) jobs = (int)(size / PARSE_CHUNK_MIN);
+    if (jobs < 2) return NULL;
+
+    size_t *starts = (size_t *)COC_MALLOC(jobs * sizeof(size_t));
+    int *lines = (int *)COC_MALLOC(jobs * sizeof(int));
+    COC_ASSERT(starts != NULL && lines != NULL);
+    int count = parse_split(src, size, jobs, starts, lines);
+    if (count < 2) return NULL;
+    ParseChunk *chunks = (ParseChunk *)COC_CALLOC(count, sizeof(ParseChunk));
+    pthread_t *threads = (pthread_t *)COC_CALLOC(count, sizeof(pthread_t));
+    bool *started = (bool *)COC_CALLOC(count, sizeof(bool));
+    COC_ASSERT(chunks != NULL && threads != NULL && started != NULL);
+    for (int i = 0; i < count; i++) {
+        size_t end = i + 1 < count ? starts[i + 1] : size;
+        chunks[i].src = (Coc_String){
+            .items    = (char *)src + starts[i],
+            .size     = end - starts[i],
+            .capacity = end - starts[i],
+            .not_sso  = true
+        };
+        chunks[i].line = lines[i];
+    }
+    for (int i = 1; i < count; i++) {
+        int err = pthread_create(&threads[i], NULL, parse_chunk_main, &chunks[i]);
+        if (err != 0) {
+            coc_log(COC_WARNING, "Cannot start parser thread: %s", strerror(err));
+            break;
+        }
+        started[i] = true;
+    }
+    // The first chunk, and any that did not get a thread, are parsed here;
+    // the lexer time of --stats only covers these
+    for (int i = 0; i < count; i++) {
+        if (!started[i]) parse_chunk_main(&chunks[i]);
+    }
+    for (int i = 1; i < count; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+    }
+
+    // From here on everything belongs to the module's arena
+    size_t total = 1;
+    const PunctaError *error = NULL;
+    for (int i = 0; i < count; i++) {
+        coc_arena_merge(coc_global_arena, &chunks[i].arena);
+        total += chunks[i].prog.size;
+        if (error == NULL && chunks[i].error.status != PUNCTA_OK) error = &chunks[i].error;
+    }
+    if (error != NULL) puncta_raise(error->status, error->line, "%s", error->message);
+    Module *m = (Module *)COC_MALLOC(sizeof(Module));
+    if (m == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Module init: malloc() failed");
+    }
+    *m = (Module){0};
+    // The program grows out of the first slice's, and every other slice is
+    // freed once it has been appended, so the instructions are never held
+    // twice. Large arrays are malloc'ed by the arena, so this really frees.
+    m->prog = chunks[0].prog;
+    chunks[0].prog = (Program){0};
+    m->prog.items = (Instruction *)COC_REALLOC(m->prog.items, total * sizeof(Instruction));
+    if (m->prog.items == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Module init: realloc() failed");
+    }
+    m->prog.capacity = total;
+    size_t label_count = 0;
+    for (int i = 0; i < count; i++) label_count += chunks[i].labels.size;
+    coc_ht_resize(&m->labels, label_count);
+    for (int i = 0; i < count; i++) {
+        ParseChunk *c = &chunks[i];
+        int base = i == 0 ? 0 : (int)m->prog.size;
+        if (i > 0) {
+            memcpy(m->prog.items + m->prog.size, c->prog.items, c->prog.size * sizeof(Instruction));
+            m->prog.size += c->prog.size;
+            coc_vec_free(&c->prog);
+        }
+        for (size_t j = 0; j < c->labels.size; j++) {
+            LabelEntry *e = &c->labels.items[j];
+            coc_ht_insert_move(&m->labels, &e->key, base + e->value);
+        }
+        coc_vec_free(&c->labels);
+    }
+    m->prog.items[m->prog.size++] = (Instruction){.op = OP_END};
+    coc_log(COC_DEBUG, "Parsed %zu bytes in %d chunks", size, count);
+    coc_str_free(source);
+    return m;
+#else
+    COC_UNUSED(source);
+    return NULL;
+#endif // _WIN32
+}
+
+// Returns NULL on a compile error, described by puncta_last_error()
+static inline VM *compile_source(Coc_String source) {
+    PerfMark mark;
+    perf_phase_begin(&mark);
+    // Everything the compiler allocates goes into one arena owned by the module
+    Coc_Arena arena = {0};
+    Coc_Arena *prev_arena = coc_arena_begin(&arena);
+    // The source is heap memory until module_init() frees it with the lexer
+    volatile bool owns_source = true;
+    PunctaTrap trap;
+    puncta_trap_push(&trap, &puncta_error);
+    if (setjmp(trap.env) != 0) {
+        coc_arena_end(prev_arena);
+        coc_arena_free(&arena);
+        if (owns_source) coc_str_free(&source);
+        return NULL;
+    }
+    Module *m = parse_parallel(&source);
+    if (m == NULL) {
+        Lexer *lex = lexer_init(source);
+        Parser *parser = parser_init(lex);
+        parse_program(parser);
+        m = module_init(parser);
+    }
+    owns_source = false;
+    coc_log(COC_DEBUG,
+        "Compile finished: %zu instructions, %zu labels",
+        m->prog.size, m->labels.size);
+    coc_arena_end(prev_arena);
+    m->arena = arena;
+    coc_log(COC_DEBUG, "Compile arena: %zu bytes used, %zu bytes reserved",
+            arena.used, arena.reserved);
+    perf_phase_end(PHASE_COMPILE, &mark);
+    perf_phase_begin(&mark);
+    module_check_labels(m);
+    module_freeze(m);
+    perf_phase_end(PHASE_LINK, &mark);
+    puncta_trap_pop(&trap);
+    puncta_error = (PunctaError){0};
+    VM *vm = vm_new(m);
+    vm->owns_module = true;
+    return vm;
+}
+
+static inline VM *compile_file(const char *filename) {
+    Coc_String source = {0};
+    PerfMark mark;
+    perf_phase_begin(&mark);
+    int err = coc_read_entire_file(filename, &source);
+    perf_phase_end(PHASE_READ, &mark);
+    if (err != 0) {
+        puncta_error = (PunctaError){.status = PUNCTA_ERR_IO};
+        snprintf(puncta_error.message, sizeof(puncta_error.message),
+                 "Cannot read file %s: %s", filename, strerror(err));
+        return NULL;
+    }
+    return compile_source(source);
+}
+
+// Bytecode file format (native byte order, version checked on load):
+//   BytecodeHeader
+//   BytecodeInst  [inst_count]   (labels already resolved into target)
+//   BytecodeLabel [label_count]
+//   char          [str_size]     (deduplicated identifier pool)
+
+#define BYTECODE_MAGIC   "PUNC"
+#define BYTECODE_VERSION 3
+#define BYTECODE_EXT     ".punc"
+
+// 128-bit digest of a source file, for the caches that reuse a compiled
+// program when the content is unchanged
+typedef struct SourceDigest {
+    uint64_t lo;
+    uint64_t hi;
+} SourceDigest;
+
+// Two wyhash-style lanes with their own seeds over the whole content, so
+// that running stale code takes a 128-bit collision, not a 32-bit one
+static inline SourceDigest source_digest(Coc_String *source) {
+    const uint64_t s0 = 0xa0761d6478bd642full, s1 = 0xe7037ed1a0b428dbull;
+    const uint64_t s2 = 0x8ebc6af09c88c6e3ull, s3 = 0x589965cc75374cc3ull;
+    const char *p = coc_str_data(source);
+    size_t size = coc_str_size(source);
+    uint64_t lo = s0 ^ size, hi = s3 ^ size;
+    for (; size >= 16; p += 16, size -= 16) {
+        uint64_t a = coc_read_u64(p), b = coc_read_u64(p + 8);
+        lo = coc_wymix(a ^ s1, b ^ lo);
+        hi = coc_wymix(b ^ s2, a ^ hi);
+    }
+    char tail[16] = {0};
+    memcpy(tail, p, size);
+    uint64_t a = coc_read_u64(tail), b = coc_read_u64(tail + 8);
+    lo = coc_wymix(lo ^ s2, coc_wymix(a ^ s1, b ^ lo));
+    hi = coc_wymix(hi ^ s1, coc_wymix(b ^ s2, a ^ hi));
+    return (SourceDigest){.lo = lo, .hi = hi};
+}
+
+static inline bool source_digest_equal(SourceDigest a, SourceDigest b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+typedef struct BytecodeSource {
+    uint64_t     size;
+    int64_t      mtime_ns;
+    int64_t      ctime_ns;
+    SourceDigest digest;
+} BytecodeSource;
+
+typedef struct BytecodeHeader {
+    char     magic[4];
+    uint32_t version;
+    uint16_t puncta_major;
+    uint16_t puncta_minor;
+    uint16_t puncta_patch;
+    uint16_t inst_size;
+    uint32_t inst_count;
+    uint32_t label_count;
+    uint64_t str_size;
+    uint64_t src_size;
+    int64_t  src_mtime_ns;
+    int64_t  src_ctime_ns;
+    uint64_t src_digest_lo;
+    uint64_t src_digest_hi;
+} BytecodeHeader;
+
+typedef struct BytecodeString {
+    uint32_t offset;
+    uint32_t size;
+} BytecodeString;
+
+typedef struct BytecodeInst {
+    BytecodeString a;
+    BytecodeString b;
+    BytecodeString label;
+    Number         number;
+    int32_t        target;
+    int32_t        line;
+    uint8_t        op;
+    uint8_t        is_B_number;
+    uint8_t        reserved[6];
+} BytecodeInst;
+
+typedef struct BytecodeLabel {
+    BytecodeString name;
+    int32_t        pos;
+    uint32_t       reserved;
+} BytecodeLabel;
+
+static inline bool bytecode_is_file(const char *filename) {
+    size_t len = strlen(filename), ext = strlen(BYTECODE_EXT);
+    return len > ext && strcmp(filename + len - ext, BYTECODE_EXT) == 0;
+}
+
+static inline BytecodeString bytecode_intern(Coc_String *pool, LabelHashTable *seen, Coc_String *str) {
+    uint32_t size = (uint32_t)coc_str_size(str);
+    if (size == 0) return (BytecodeString){0};
+    int *offset = NULL;
+    coc_ht_find(seen, str, offset);
+    if (offset != NULL) return (BytecodeString){.offset = (uint32_t)*offset, .size = size};
+    uint32_t at = (uint32_t)coc_str_size(pool);
+    coc_str_append_many(pool, coc_str_data(str), size);
+    coc_ht_insert_copy(seen, str, (int)at);
+    return (BytecodeString){.offset = at, .size = size};
+}
+
+// Writes a linked VM (labels checked) to path through a temporary file, so a
+// reader that has the old file mapped keeps a consistent image.
+// Returns 0 or errno; logging is left to the caller.
+static inline int bytecode_save(VM *vm, const char *path, const BytecodeSource *src) {
+    Module *m = vm->module;
+    int result = 0;
+    FILE *fp = NULL;
+    Coc_String pool = {0};
+    Coc_String tmp_path = {0};
+    LabelHashTable seen = {0};
+    BytecodeInst *insts = COC_CALLOC(m->prog.size + 1, sizeof(BytecodeInst));
+    BytecodeLabel *labels = COC_CALLOC(m->labels.size + 1, sizeof(BytecodeLabel));
+    if (insts == NULL || labels == NULL) coc_defer(ENOMEM);
+    for (size_t i = 0; i < m->prog.size; i++) {
+        Instruction *inst = &m->prog.items[i];
+        BytecodeInst *out = &insts[i];
+        out->a           = bytecode_intern(&pool, &seen, &inst->OperandA);
+        out->b           = bytecode_intern(&pool, &seen, &inst->OperandB);
+        out->label       = bytecode_intern(&pool, &seen, &inst->Label);
+        out->number      = inst->number;
+        out->target      = inst->target;
+        out->line        = inst->line;
+        out->op          = (uint8_t)inst->op;
+        out->is_B_number = inst->is_B_number;
+    }
+    size_t label_count = 0;
+    for (size_t i = 0; i < m->labels.capacity; i++) {
+        LabelEntry *e = &m->labels.items[i];
+        if (!e->is_used) continue;
+        labels[label_count].name = bytecode_intern(&pool, &seen, &e->key);
+        labels[label_count].pos  = e->value;
+        label_count++;
+    }
+    BytecodeHeader header = {
+        .version       = BYTECODE_VERSION,
+        .puncta_major  = PUNCTA_VERSION_MAJOR,
+        .puncta_minor  = PUNCTA_VERSION_MINOR,
+        .puncta_patch  = PUNCTA_VERSION_PATCH,
+        .inst_size     = sizeof(BytecodeInst),
+        .inst_count    = (uint32_t)m->prog.size,
+        .label_count   = (uint32_t)label_count,
+        .str_size      = coc_str_size(&pool),
+        .src_size      = src ? src->size      : 0,
+        .src_mtime_ns  = src ? src->mtime_ns  : 0,
+        .src_ctime_ns  = src ? src->ctime_ns  : 0,
+        .src_digest_lo = src ? src->digest.lo : 0,
+        .src_digest_hi = src ? src->digest.hi : 0
+    };
+    memcpy(header.magic, BYTECODE_MAGIC, sizeof(header.magic));
+
+    coc_str_append(&tmp_path, path);
+    coc_str_append(&tmp_path, ".tmp");
+    coc_str_append_null(&tmp_path);
+    fp = fopen(coc_str_data(&tmp_path), "wb");
+    if (fp == NULL) coc_defer(errno);
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(insts, sizeof(BytecodeInst), m->prog.size, fp);
+    fwrite(labels, sizeof(BytecodeLabel), label_count, fp);
+    fwrite(coc_str_data(&pool), 1, coc_str_size(&pool), fp);
+    if (ferror(fp)) coc_defer(EIO);
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        coc_defer(errno);
+    }
+    fp = NULL;
+#ifdef _WIN32
+    remove(path);
+#endif // _WIN32
+    if (rename(coc_str_data(&tmp_path), path) != 0) coc_defer(errno);
+defer:
+    if (fp) fclose(fp);
+    if (result != 0 && coc_str_size(&tmp_path) > 0) remove(coc_str_data(&tmp_path));
+    COC_FREE(insts);
+    COC_FREE(labels);
+    coc_str_free(&pool);
+    coc_str_free(&tmp_path);
+    coc_ht_free(&seen);
+    return result;
+}
+
+static inline const char *bytecode_check(const char *data, size_t size) {
+    if (size < sizeof(BytecodeHeader)) return "file too small";
+    const BytecodeHeader *h = (const BytecodeHeader *)data;
+    if (memcmp(h->magic, BYTECODE_MAGIC, sizeof(h->magic)) != 0) return "not a bytecode file";
+    if (h->version != BYTECODE_VERSION || h->inst_size != sizeof(BytecodeInst))
+        return "unsupported bytecode format";
+    if (h->puncta_major != PUNCTA_VERSION_MAJOR ||
+        h->puncta_minor != PUNCTA_VERSION_MINOR ||
+        h->puncta_patch != PUNCTA_VERSION_PATCH)
+        return "compiled by a different Puncta version";
+    uint64_t need = sizeof(BytecodeHeader)
+                  + (uint64_t)h->inst_count  * sizeof(BytecodeInst)
+                  + (uint64_t)h->label_count * sizeof(BytecodeLabel)
+                  + h->str_size;
+    if (need != size) return "truncated or corrupted file";
+    return NULL;
+}
+
+static inline Coc_String bytecode_string(const char *pool, BytecodeString str) {
+    if (str.size == 0) return (Coc_String){0};
+    return (Coc_String){
+        .items    = (char *)pool + str.offset,
+        .size     = str.size,
+        .capacity = str.size,
+        .not_sso  = true
+    };
+}
+
+// Builds a module straight from a file image and a VM owning it. Identifier
+// strings are borrowed from the image, which stays mapped until vm_free().
+static inline VM *bytecode_load_image(Coc_File_Map image, const char *path, Coc_Log_Level level) {
+    const char *result = bytecode_check(image.data, image.size);
+    Coc_Arena arena = {0};
+    Coc_Arena *prev_arena = NULL;
+    if (result != NULL) goto defer;
+    const BytecodeHeader *h = (const BytecodeHeader *)image.data;
+    const BytecodeInst *insts = (const BytecodeInst *)(image.data + sizeof(BytecodeHeader));
+    const BytecodeLabel *labels = (const BytecodeLabel *)(insts + h->inst_count);
+    const char *pool = (const char *)(labels + h->label_count);
+
+    prev_arena = coc_arena_begin(&arena);
+    Module *m = (Module *)COC_MALLOC(sizeof(Module));
+    *m = (Module){0};
+    m->prog.items    = COC_MALLOC((h->inst_count + 1) * sizeof(Instruction));
+    m->prog.capacity = h->inst_count;
+    for (uint32_t i = 0; i < h->inst_count; i++) {
+        const BytecodeInst *in = &insts[i];
+        if (in->op > OP_RET) coc_defer("invalid opcode");
+        if (in->a.offset + (uint64_t)in->a.size > h->str_size ||
+            in->b.offset + (uint64_t)in->b.size > h->str_size ||
+            in->label.offset + (uint64_t)in->label.size > h->str_size)
+            coc_defer("string out of range");
+        if ((in->op == OP_JMP || in->op == OP_JEQ || in->op == OP_CALL) &&
+            (in->target < 0 || (uint32_t)in->target > h->inst_count))
+            coc_defer("jump target out of range");
+        Instruction *inst = &m->prog.items[m->prog.size++];
+        *inst = (Instruction){0};
+        inst->OperandA    = bytecode_string(pool, in->a);
+        inst->OperandB    = bytecode_string(pool, in->b);
+        inst->Label       = bytecode_string(pool, in->label);
+        inst->number      = in->number;
+        inst->op          = (OpCode)in->op;
+        inst->line        = in->line;
+        inst->target      = in->target;
+        inst->is_B_number = in->is_B_number;
+    }
+    uint64_t link_start = perf_counters != NULL ? coc_now_ns() : 0;
+    for (uint32_t i = 0; i < h->label_count; i++) {
+        const BytecodeLabel *in = &labels[i];
+        if (in->name.size == 0 || in->name.offset + (uint64_t)in->name.size > h->str_size)
+            coc_defer("string out of range");
+        if (in->pos < 0 || (uint32_t)in->pos > h->inst_count)
+            coc_defer("label position out of range");
+        Coc_String name = bytecode_string(pool, in->name);
+        int *pos = NULL;
+        coc_ht_find(&m->labels, &name, pos);
+        if (pos != NULL) coc_defer("duplicate label");
+        coc_ht_insert_move(&m->labels, &name, in->pos);
+    }
+    coc_arena_end(prev_arena);
+    m->arena = arena;
+    m->image = image;
+    module_freeze(m);
+    if (perf_counters != NULL) perf_counters->load_link_ns += coc_now_ns() - link_start;
+    coc_log(COC_DEBUG, "Load bytecode %s: %u instructions, %u labels",
+            path, h->inst_count, h->label_count);
+    VM *vm = vm_new(m);
+    vm->owns_module = true;
+    return vm;
+defer:
+    if (coc_global_arena == &arena) coc_arena_end(prev_arena);
+    coc_arena_free(&arena);
+    coc_unmap_file(&image);
+    coc_log(level, "Cannot load bytecode file %s: %s", path, result);
+    return NULL;
+}
+
+static inline VM *bytecode_load(const char *path) {
+    Coc_File_Map image = {0};
+    PerfMark mark;
+    perf_phase_begin(&mark);
+    int err = coc_map_file(path, &image);
+    if (err != 0) {
+        coc_log(COC_FATAL, "Cannot read file %s: %s", path, strerror(err));
+        return NULL;
+    }
+    VM *vm = bytecode_load_image(image, path, COC_ERROR);
+    perf_phase_end(PHASE_LOAD, &mark);
+    return vm;
+}
+
+// Cache file next to the source: foo.pun -> foo.punc
+static inline void bytecode_cache_path(const char *filename, Coc_String *path) {
+    coc_str_append(path, filename);
+    size_t len = strlen(filename);
+    if (len >= 4 && strcmp(filename + len - 4, ".pun") == 0) coc_str_push(path, 'c');
+    else coc_str_append(path, BYTECODE_EXT);
+    coc_str_append_null(path);
+}
+
+static inline int64_t stat_mtime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_mtime * 1000000000;
+#else
+    return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif // __APPLE__
+}
+
+static inline int64_t stat_ctime_ns(const struct stat *st) {
+#if defined(__APPLE__)
+    return (int64_t)st->st_ctimespec.tv_sec * 1000000000 + st->st_ctimespec.tv_nsec;
+#elif defined(_WIN32)
+    return (int64_t)st->st_ctime * 1000000000;
+#else
+    return (int64_t)st->st_ctim.tv_sec * 1000000000 + st->st_ctim.tv_nsec;
+#endif // __APPLE__
+}
+
+// Bytecode cache lookups of this process, reported by --metrics
+static _Atomic uint64_t bytecode_cache_hits   = 0;
+static _Atomic uint64_t bytecode_cache_misses = 0;
+
+// The cache is trusted without reading the source when size, mtime and ctime
+// match and the source was last changed strictly before the cache was
+// written: timestamps are coarse, so a rewrite in the same tick as the save
+// could otherwise keep all three. In every other case the source is read and
+// the cache is reused (and refreshed) if its 128-bit digest matches.
+
+static inline VM *compile_file_cached(const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return compile_file(filename);
+    BytecodeSource src = {.size     = (uint64_t)st.st_size,
+                          .mtime_ns = stat_mtime_ns(&st),
+                          .ctime_ns = stat_ctime_ns(&st)};
+    Coc_String cache_path = {0};
+    bytecode_cache_path(filename, &cache_path);
+    const char *cache = coc_str_data(&cache_path);
+    struct stat cache_st;
+    bool stamp_settled = stat(cache, &cache_st) == 0 && src.ctime_ns < stat_mtime_ns(&cache_st);
+
+    VM *vm = NULL;
+    PerfMark mark;
+    perf_phase_begin(&mark);
+    BytecodeHeader header = {0};
+    Coc_File_Map image = {0};
+    bool has_image = coc_map_file(cache, &image) == 0 &&
+                     bytecode_check(image.data, image.size) == NULL;
+    if (has_image) memcpy(&header, image.data, sizeof(header));
+    else coc_unmap_file(&image);
+    if (has_image && stamp_settled && header.src_size == src.size &&
+        header.src_mtime_ns == src.mtime_ns && header.src_ctime_ns == src.ctime_ns) {
+        has_image = false;
+        vm = bytecode_load_image(image, cache, COC_DEBUG);
+        if (vm != NULL) {
+            perf_phase_end(PHASE_LOAD, &mark);
+            coc_log(COC_DEBUG, "Bytecode cache hit: %s", cache);
+            bytecode_cache_hits++;
+            coc_str_free(&cache_path);
+            return vm;
+        }
+    }
+    perf_phase_end(PHASE_LOAD, &mark);
+    perf_phase_begin(&mark);
+    Coc_String source = {0};
+    if (coc_read_entire_file(filename, &source) != 0) {
+        if (has_image) coc_unmap_file(&image);
+        coc_str_free(&cache_path);
+        return NULL;
+    }
+    src.digest = source_digest(&source);
+    perf_phase_end(PHASE_READ, &mark);
+    SourceDigest cached = {.lo = header.src_digest_lo, .hi = header.src_digest_hi};
+    if (has_image && header.src_size == src.size && source_digest_equal(cached, src.digest)) {
+        has_image = false;
+        perf_phase_begin(&mark);
+        vm = bytecode_load_image(image, cache, COC_DEBUG);
+        perf_phase_end(PHASE_LOAD, &mark);
+        if (vm != NULL) {
+            bytecode_cache_hits++;
+            coc_str_free(&source);
+        }
+    }
+    if (has_image) coc_unmap_file(&image);
+    if (vm == NULL) {
+        coc_log(COC_DEBUG, "Bytecode cache miss: %s", cache);
+        bytecode_cache_misses++;
+        vm = compile_source(source);
+        if (vm == NULL) {
+            coc_str_free(&cache_path);
+            return NULL;
+        }
+    }
+    int err = bytecode_save(vm, cache, &src);
+    if (err != 0) coc_log(COC_WARNING, "Cannot write bytecode cache %s: %s", cache, strerror(err));
+    coc_str_free(&cache_path);
+    return vm;
+}
+
+#define PROFILE_TOP 20
+
+typedef struct ProfileLine {
+    int      line;
+    uint64_t count;
+    uint64_t cycles;
+} ProfileLine;
+
+typedef struct ProfileLines {
+    ProfileLine *items;
+    size_t       size;
+    size_t       capacity;
+} ProfileLines;
+
+typedef struct ProfileAction {
+    Coc_String *name;
+    uint64_t    calls;
+    uint64_t    cycles;
+} ProfileAction;
+
+typedef struct ProfileActions {
+    ProfileAction *items;
+    size_t         size;
+    size_t         capacity;
+} ProfileActions;
+
+// Action function -> slot in ProfileActions, an IntHashTable (coc_iht_*)
+typedef struct ProfileActionEntry {
+    uint64_t  key;
+    long long value;
+    bool      is_used;
+} ProfileActionEntry;
+
+typedef struct ProfileActionIndex {
+    ProfileActionEntry *items;
+    ProfileActionEntry *new_items;
+    uint8_t            *ctrl;
+    size_t              size;
+    size_t              tombstones;
+    size_t              capacity;
+} ProfileActionIndex;
+
+static inline void profile_start(VM *vm, Profile *prof) {
+    size_t n = vm->module->prog.size > 0 ? vm->module->prog.size : 1;
+    prof->counts = (uint64_t *)COC_CALLOC(n, sizeof(uint64_t));
+    prof->cycles = (uint64_t *)COC_CALLOC(n, sizeof(uint64_t));
+    if (prof->counts == NULL || prof->cycles == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Profile: calloc() failed");
+    }
+    prof->start = coc_cycles();
+    prof->total = 0;
+    vm->profile = prof;
+}
+
+static inline void profile_stop(VM *vm) {
+    Profile *prof = vm->profile;
+    prof->total = coc_cycles() - prof->start;
+    vm->profile = NULL;
+}
+
+static inline void profile_free(Profile *prof) {
+    COC_FREE(prof->counts);
+    COC_FREE(prof->cycles);
+    *prof = (Profile){0};
+}
+
+static inline int profile_line_cmp(const void *a, const void *b) {
+    const ProfileLine *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->line - y->line;
+}
+
+static inline int profile_action_cmp(const void *a, const void *b) {
+    const ProfileAction *x = a, *y = b;
+    if (x->cycles != y->cycles) return x->cycles < y->cycles ? 1 : -1;
+    return x->calls < y->calls ? 1 : x->calls > y->calls ? -1 : 0;
+}
+
+// Folds instruction counters into per-line and per-action totals,
+// both sorted hottest first. Actions are keyed by the function they
+// resolved to, so names registered for one function share its row.
+COC_COLD static uint64_t profile_collect(VM *vm, const Profile *prof, ProfileLines *lines, ProfileActions *acts) {
+    uint64_t executed = 0;
+    int max_line = 0;
+    for (size_t i = 0; i < vm->module->prog.size; i++)
+        if (vm->module->prog.items[i].line > max_line) max_line = vm->module->prog.items[i].line;
+    ProfileLine *by_line = (ProfileLine *)COC_CALLOC((size_t)max_line + 1, sizeof(ProfileLine));
+    ProfileActionIndex act_index = {0};
+    for (size_t i = 0; i < vm->module->prog.size; i++) {
+        Instruction *inst = &vm->module->prog.items[i];
+        // The OP_END sentinel has no source line
+        if (inst->op == OP_END) continue;
+        executed += prof->counts[i];
+        ProfileLine *pl = &by_line[inst->line];
+        pl->line    = inst->line;
+        pl->count  += prof->counts[i];
+        pl->cycles += prof->cycles[i];
+        if (inst->op != OP_ACT || prof->counts[i] == 0) continue;
+        uint64_t key = (uint64_t)(uintptr_t)vm_inst_action(vm, inst);
+        long long *index = NULL;
+        coc_iht_find(&act_index, key, index);
+        size_t slot = index != NULL ? (size_t)*index : acts->size;
+        if (index == NULL) {
+            coc_iht_insert(&act_index, key, (long long)slot);
+            coc_vec_append(acts, ((ProfileAction){&inst->OperandB, 0, 0}));
+        }
+        acts->items[slot].calls  += prof->counts[i];
+        acts->items[slot].cycles += prof->cycles[i];
+    }
+    for (int line = 0; line <= max_line; line++)
+        if (by_line[line].count > 0) coc_vec_append(lines, by_line[line]);
+    COC_FREE(by_line);
+    coc_iht_free(&act_index);
+    if (lines->size > 0) qsort(lines->items, lines->size, sizeof(ProfileLine), profile_line_cmp);
+    if (acts->size > 0) qsort(acts->items, acts->size, sizeof(ProfileAction), profile_action_cmp);
+    return executed;
+}
+
+static inline void profile_report(VM *vm, const Profile *prof, FILE *out) {
+    ProfileLines lines = {0};
+    ProfileActions acts = {0};
+    uint64_t executed = profile_collect(vm, prof, &lines, &acts);
+    uint64_t act_cycles = 0;
+    for (size_t i = 0; i < acts.size; i++) act_cycles += acts.items[i].cycles;
+    double total = executed > 0 ? (double)executed : 1.0;
+    fprintf(out, "Profile: %llu instructions, %llu cycles, %llu in actions\n",
+            (unsigned long long)executed, (unsigned long long)prof->total, (unsigned long long)act_cycles);
+    fprintf(out, "\nHot lines:\n%8s %14s %7s %16s\n", "line", "count", "%", "action cycles");
+    for (size_t i = 0; i < lines.size && i < PROFILE_TOP; i++) {
+        ProfileLine *pl = &lines.items[i];
+        fprintf(out, "%8d %14llu %6.2f%% %16llu\n", pl->line, (unsigned long long)pl->count,
+                100.0 * pl->count / total, (unsigned long long)pl->cycles);
+    }
+    double total_act = act_cycles > 0 ? (double)act_cycles : 1.0;
+    fprintf(out, "\nHot actions:\n%-16s %14s %16s %12s %7s\n", "action", "calls", "cycles", "cycles/call", "%");
+    for (size_t i = 0; i < acts.size && i < PROFILE_TOP; i++) {
+        ProfileAction *pa = &acts.items[i];
+        fprintf(out, "%-16.*s %14llu %16llu %12.1f %6.2f%%\n",
+                (int)coc_str_size(pa->name), coc_str_data(pa->name),
+                (unsigned long long)pa->calls, (unsigned long long)pa->cycles,
+                (double)pa->cycles / pa->calls, 100.0 * pa->cycles / total_act);
+    }
+    coc_vec_free(&lines);
+    coc_vec_free(&acts);
+}
+
+// Action names are identifiers, so they need no escaping
+static inline int profile_write_json(VM *vm, const Profile *prof, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return errno;
+    ProfileLines lines = {0};
+    ProfileActions acts = {0};
+    uint64_t executed = profile_collect(vm, prof, &lines, &acts);
+    fprintf(fp, "{\"instructions\":%llu,\"cycles\":%llu,\"lines\":[",
+            (unsigned long long)executed, (unsigned long long)prof->total);
+    for (size_t i = 0; i < lines.size; i++) {
+        ProfileLine *pl = &lines.items[i];
+        fprintf(fp, "%s{\"line\":%d,\"count\":%llu,\"cycles\":%llu}", i ? "," : "",
+                pl->line, (unsigned long long)pl->count, (unsigned long long)pl->cycles);
+    }
+    fprintf(fp, "],\"actions\":[");
+    for (size_t i = 0; i < acts.size; i++) {
+        ProfileAction *pa = &acts.items[i];
+        fprintf(fp, "%s{\"name\":\"%.*s\",\"calls\":%llu,\"cycles\":%llu}", i ? "," : "",
+                (int)coc_str_size(pa->name), coc_str_data(pa->name),
+                (unsigned long long)pa->calls, (unsigned long long)pa->cycles);
+    }
+    fprintf(fp, "]}\n");
+    coc_vec_free(&lines);
+    coc_vec_free(&acts);
+    int err = ferror(fp) ? EIO : 0;
+    if (fclose(fp) != 0 && err == 0) err = errno;
+    return err;
+}
+
+#define SAMPLE_MAX_HZ 10000
+
+// Sampling profiler: SIGPROF reads vm->pc into a per-instruction counter
+// array allocated up front, so the handler never allocates or locks.
+// An OP_ACT pc means its action is running (pc advances after the call).
+// counts[prog.size] collects samples taken after the program ended.
+typedef struct Sampler {
+    uint32_t              *counts;
+    size_t                 size;
+    volatile sig_atomic_t  active;
+    uint64_t               total;
+    int                    hz;
+} Sampler;
+
+static VM      *sample_vm      = NULL;
+static Sampler *sample_sampler = NULL;
+
+#ifndef _WIN32
+static void sample_handler(int sig) {
+    COC_UNUSED(sig);
+    Sampler *sampler = sample_sampler;
+    if (sampler == NULL || !sampler->active) return;
+    int pc = *(volatile int *)&sample_vm->pc;
+    if (pc < 0 || (size_t)pc >= sampler->size) pc = (int)sampler->size - 1;
+    sampler->counts[pc]++;
+    sampler->total++;
+}
+#endif // _WIN32
+
+// Returns 0 or errno
+static inline int sample_start(VM *vm, Sampler *sampler, int hz) {
+    *sampler = (Sampler){0};
+#ifndef _WIN32
+    sampler->size   = vm->module->prog.size + 1;
+    sampler->counts = (uint32_t *)COC_CALLOC(sampler->size, sizeof(uint32_t));
+    if (sampler->counts == NULL) return ENOMEM;
+    sampler->hz     = hz;
+    sampler->active = 1;
+    sample_vm       = vm;
+    sample_sampler  = sampler;
+    struct sigaction sa = {0};
+    sa.sa_handler = sample_handler;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) < 0) return errno;
+    long usec = 1000000L / hz;
+    if (usec <= 0) usec = 1;
+    struct itimerval timer = {
+        .it_interval = {usec / 1000000L, usec % 1000000L},
+        .it_value    = {usec / 1000000L, usec % 1000000L},
+    };
+    if (setitimer(ITIMER_PROF, &timer, NULL) < 0) return errno;
+    return 0;
+#else
+    COC_UNUSED(vm);
+    COC_UNUSED(hz);
+    return ENOSYS;
+#endif // _WIN32
+}
+
+static inline void sample_stop(Sampler *sampler) {
+#ifndef _WIN32
+    struct itimerval timer = {0};
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sampler->active = 0;
+    signal(SIGPROF, SIG_IGN);
+#endif // _WIN32
+    sample_sampler = NULL;
+    sample_vm      = NULL;
+}
+
+static inline void sample_free(Sampler *sampler) {
+    COC_FREE(sampler->counts);
+    *sampler = (Sampler){0};
+}
+
+// Frame names must not contain ';', which separates folded frames
+static inline void sample_frame(Coc_String *out, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) coc_str_push(out, data[i] == ';' ? '_' : data[i]);
+}
+
+typedef struct SampleTotals {
+    uint64_t *items;
+    size_t    size;
+    size_t    capacity;
+} SampleTotals;
+
+typedef struct SampleStacks {
+    Coc_String *items;
+    size_t      size;
+    size_t      capacity;
+} SampleStacks;
+
+// Folded stacks ("file;label;line N;action count"), one line per distinct
+// stack, as read by flamegraph.pl and speedscope
+COC_COLD static int sample_write_folded(VM *vm, Sampler *sampler, const char *name, const char *path) {
+    // Nearest label at or before each instruction
+    Coc_String **label_at = (Coc_String **)COC_CALLOC(sampler->size, sizeof(Coc_String *));
+    if (label_at == NULL) return ENOMEM;
+    for (size_t i = 0; i < vm->module->labels.capacity; i++) {
+        LabelEntry *e = &vm->module->labels.items[i];
+        if (!e->is_used || e->value < 0 || (size_t)e->value >= sampler->size) continue;
+        label_at[e->value] = &e->key;
+    }
+    for (size_t i = 1; i < sampler->size; i++)
+        if (label_at[i] == NULL) label_at[i] = label_at[i - 1];
+
+    const char *base = strrchr(name, '/');
+    base = base != NULL ? base + 1 : name;
+    LabelHashTable index = {0};
+    SampleTotals totals = {0};
+    SampleStacks stacks = {0};
+    for (size_t pc = 0; pc < sampler->size; pc++) {
+        if (sampler->counts[pc] == 0) continue;
+        Coc_String stack = {0};
+        sample_frame(&stack, base, strlen(base));
+        coc_str_push(&stack, ';');
+        if (pc == vm->module->prog.size) {
+            coc_str_append(&stack, "(exit)");
+        } else {
+            Instruction *inst = &vm->module->prog.items[pc];
+            if (label_at[pc] != NULL) sample_frame(&stack, coc_str_data(label_at[pc]), coc_str_size(label_at[pc]));
+            else coc_str_append(&stack, "(top)");
+            char line[32];
+            snprintf(line, sizeof(line), ";line %d", inst->line);
+            coc_str_append(&stack, line);
+            if (inst->op == OP_ACT) {
+                coc_str_push(&stack, ';');
+                sample_frame(&stack, coc_str_data(&inst->OperandB), coc_str_size(&inst->OperandB));
+            }
+        }
+        int *slot = NULL;
+        coc_ht_find(&index, &stack, slot);
+        if (slot != NULL) {
+            totals.items[*slot] += sampler->counts[pc];
+            coc_str_free(&stack);
+            continue;
+        }
+        coc_ht_insert_copy(&index, &stack, (int)stacks.size);
+        coc_vec_append(&totals, (uint64_t)sampler->counts[pc]);
+        coc_vec_append(&stacks, stack);
+    }
+    int err = 0;
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        err = errno;
+    } else {
+        for (size_t i = 0; i < stacks.size; i++)
+            fprintf(fp, "%.*s %llu\n", (int)coc_str_size(&stacks.items[i]), coc_str_data(&stacks.items[i]),
+                    (unsigned long long)totals.items[i]);
+        if (ferror(fp)) err = EIO;
+        if (fclose(fp) != 0 && err == 0) err = errno;
+    }
+    for (size_t i = 0; i < stacks.size; i++) coc_str_free(&stacks.items[i]);
+    coc_vec_free(&stacks);
+    coc_vec_free(&totals);
+    coc_ht_free(&index);
+    COC_FREE(label_at);
+    return err;
+}
+
+static inline size_t stats_program_bytes(const Program *prog) {
+    size_t bytes = prog->capacity * sizeof(Instruction);
+    for (size_t i = 0; i < prog->size; i++) {
+        const Instruction *inst = &prog->items[i];
+        if (inst->OperandA.not_sso) bytes += inst->OperandA.capacity;
+        if (inst->OperandB.not_sso) bytes += inst->OperandB.capacity;
+        if (inst->Label.not_sso)    bytes += inst->Label.capacity;
+    }
+    return bytes;
+}
+
+static inline void stats_print_table(FILE *out, const char *name, const Coc_Ht_Stats *st) {
+    fprintf(out, "  %-16s %8zu / %-8zu %10zu bytes  probe avg %.2f max %zu  tombstones %zu\n",
+            name, st->size, st->capacity, st->bytes,
+            st->size > 0 ? (double)st->probe_total / st->size : 0.0, st->probe_max, st->tombstones);
+}
+
+// Label checking of a loaded bytecode file is timed inside PHASE_LOAD; the
+// link row counts it with the link phase of a compile, so it is always there
+static inline uint64_t stats_load_link_ns(const PerfCounters *perf) {
+    return perf->load_link_ns < perf->ns[PHASE_LOAD] ? perf->load_link_ns : perf->ns[PHASE_LOAD];
+}
+
+static inline uint64_t stats_phase_ns(const PerfCounters *perf, int p) {
+    if (p == PHASE_LINK) return perf->ns[p] + stats_load_link_ns(perf);
+    if (p == PHASE_LOAD) return perf->ns[p] - stats_load_link_ns(perf);
+    return perf->ns[p];
+}
+
+COC_COLD static void stats_report(VM *vm, const PerfCounters *perf, FILE *out) {
+    fprintf(out, "Stats:\n");
+    uint64_t total = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (!perf->seen[p] && !(p == PHASE_LINK && perf->seen[PHASE_LOAD])) continue;
+        total += perf->ns[p];
+        if (p == PHASE_COMPILE) {
+            uint64_t lex = perf->lex_ns < perf->ns[p] ? perf->lex_ns : perf->ns[p];
+            fprintf(out, "  %-16s %12.3f ms\n", "lex", lex / 1e6);
+            fprintf(out, "  %-16s %12.3f ms\n", "parse", (perf->ns[p] - lex) / 1e6);
+        } else {
+            fprintf(out, "  %-16s %12.3f ms\n", phase_names[p], stats_phase_ns(perf, p) / 1e6);
+        }
+    }
+    fprintf(out, "  %-16s %12.3f ms\n", "total", total / 1e6);
+    if (vm != NULL) {
+        double run_sec = perf->ns[PHASE_RUN] / 1e9;
+        fprintf(out, "  %-16s %12llu (%.1f M/s)\n", "instructions", (unsigned long long)vm->steps,
+                run_sec > 0 ? vm->steps / run_sec / 1e6 : 0.0);
+    }
+    if (coc_heap_stats_available())
+        fprintf(out, "  %-16s %12zu bytes (%zu allocs, %zu frees, %zu still in use)\n", "peak heap",
+                coc_global_heap.peak, coc_global_heap.allocs, coc_global_heap.frees, coc_global_heap.current);
+    else
+        fprintf(out, "  %-16s %12s\n", "peak heap", "n/a");
+    if (vm == NULL) return;
+    fprintf(out, "  %-16s %8zu / %-8zu %10zu bytes\n", "Program",
+            vm->module->prog.size, vm->module->prog.capacity, stats_program_bytes(&vm->module->prog));
+    Coc_Ht_Stats st;
+    coc_ht_stats(&vm->vars, &st);
+    stats_print_table(out, "VarHashTable", &st);
+    coc_ht_stats(&vm->module->labels, &st);
+    stats_print_table(out, "LabelHashTable", &st);
+    coc_ht_stats(&vm->acts, &st);
+    stats_print_table(out, "ActHashTable", &st);
+}
+
+static inline void stats_write_table_json(FILE *fp, const char *name, const Coc_Ht_Stats *st) {
+    fprintf(fp, ",\"%s\":{\"size\":%zu,\"capacity\":%zu,\"bytes\":%zu,\"tombstones\":%zu,"
+            "\"probe_avg\":%.4f,\"probe_max\":%zu}",
+            name, st->size, st->capacity, st->bytes, st->tombstones,
+            st->size > 0 ? (double)st->probe_total / st->size : 0.0, st->probe_max);
+}
+
+// Same numbers as stats_report(), phases in milliseconds
+COC_COLD static int stats_write_json(VM *vm, const PerfCounters *perf, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) return errno;
+    uint64_t total = 0;
+    fprintf(fp, "{\"phases\":{");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        total += perf->ns[p];
+        if (p == PHASE_COMPILE) {
+            uint64_t lex = perf->lex_ns < perf->ns[p] ? perf->lex_ns : perf->ns[p];
+            fprintf(fp, "\"lex\":%.6f,\"parse\":%.6f,", lex / 1e6, (perf->ns[p] - lex) / 1e6);
+        } else {
+            fprintf(fp, "\"%s\":%.6f,", phase_names[p], stats_phase_ns(perf, p) / 1e6);
+        }
+    }
+    fprintf(fp, "\"total\":%.6f}", total / 1e6);
+    if (coc_heap_stats_available())
+        fprintf(fp, ",\"peak_heap\":%zu", coc_global_heap.peak);
+    if (vm != NULL) {
+        double run_sec = perf->ns[PHASE_RUN] / 1e9;
+        fprintf(fp, ",\"instructions\":%llu,\"instructions_per_sec\":%.1f,\"program_bytes\":%zu",
+                (unsigned long long)vm->steps, run_sec > 0 ? vm->steps / run_sec : 0.0,
+                stats_program_bytes(&vm->module->prog));
+        Coc_Ht_Stats st;
+        coc_ht_stats(&vm->vars, &st);
+        stats_write_table_json(fp, "vars", &st);
+        coc_ht_stats(&vm->module->labels, &st);
+        stats_write_table_json(fp, "labels", &st);
+        coc_ht_stats(&vm->acts, &st);
+        stats_write_table_json(fp, "acts", &st);
+    }
+    fprintf(fp, "}\n");
+    int err = ferror(fp) ? EIO : 0;
+    if (fclose(fp) != 0 && err == 0) err = errno;
+    return err;
+}
+
+typedef struct MetricsSnapshot {
+    uint64_t instructions;
+    uint64_t jumps;
+    uint64_t actions;
+    uint64_t evals;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+} MetricsSnapshot;
+
+// Safe to call from any thread while the VM runs; values are at most
+// METRICS_BATCH instructions old. Returns false when metrics are off.
+static inline bool metrics_read(VM *vm, MetricsSnapshot *out) {
+    *out = (MetricsSnapshot){0};
+    Metrics *m = vm->metrics;
+    if (m == NULL) return false;
+    out->instructions = atomic_load_explicit(&m->published[METRIC_INSTRUCTIONS], memory_order_relaxed);
+    out->jumps        = atomic_load_explicit(&m->published[METRIC_JUMPS], memory_order_relaxed);
+    out->actions      = atomic_load_explicit(&m->published[METRIC_ACTIONS], memory_order_relaxed);
+    out->bytes_in     = atomic_load_explicit(&m->published[METRIC_BYTES_IN], memory_order_relaxed);
+    out->bytes_out    = atomic_load_explicit(&m->published[METRIC_BYTES_OUT], memory_order_relaxed);
+    for (size_t i = 0; i < m->name_count; i++) {
+        Coc_String *name = m->names[i];
+        if (coc_str_size(name) == 4 && memcmp(coc_str_data(name), "eval", 4) == 0)
+            out->evals = atomic_load_explicit(&m->published_calls[i], memory_order_relaxed);
+    }
+    out->cache_hits   = bytecode_cache_hits;
+    out->cache_misses = bytecode_cache_misses;
+    return true;
+}
+
+// Calls of one action so far, 0 when it is not used or metrics are off
+static inline uint64_t metrics_action_calls(VM *vm, const char *name) {
+    Metrics *m = vm->metrics;
+    if (m == NULL) return 0;
+    size_t len = strlen(name);
+    for (size_t i = 0; i < m->name_count; i++) {
+        if (coc_str_size(m->names[i]) == len && memcmp(coc_str_data(m->names[i]), name, len) == 0)
+            return atomic_load_explicit(&m->published_calls[i], memory_order_relaxed);
+    }
+    return 0;
+}
+
+static inline void metrics_write_counter(FILE *out, const char *name, const char *help, uint64_t value) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help, name, name, (unsigned long long)value);
+}
+
+// Prometheus text exposition format
+static inline void metrics_write_prometheus(VM *vm, FILE *out) {
+    MetricsSnapshot snap;
+    metrics_read(vm, &snap);
+    Metrics *m = vm->metrics;
+    fprintf(out, "# HELP puncta_running Whether the program is still running.\n"
+                 "# TYPE puncta_running gauge\npuncta_running %d\n",
+            m != NULL && atomic_load(&m->running));
+    metrics_write_counter(out, "puncta_instructions_total", "Instructions executed.", snap.instructions);
+    metrics_write_counter(out, "puncta_jumps_total", "Jumps taken, conditional and unconditional.", snap.jumps);
+    metrics_write_counter(out, "puncta_eval_calls_total", "Expressions evaluated by eval!.", snap.evals);
+    metrics_write_counter(out, "puncta_bytes_in_total", "Bytes read from standard input by actions.", snap.bytes_in);
+    metrics_write_counter(out, "puncta_bytes_out_total", "Bytes written to standard output by actions.", snap.bytes_out);
+    metrics_write_counter(out, "puncta_bytecode_cache_hits_total", "Programs loaded from the bytecode cache.", snap.cache_hits);
+    metrics_write_counter(out, "puncta_bytecode_cache_misses_total", "Programs compiled because the bytecode cache was stale.", snap.cache_misses);
+    fprintf(out, "# HELP puncta_action_calls_total Action calls by name.\n"
+                 "# TYPE puncta_action_calls_total counter\n");
+    for (size_t i = 0; m != NULL && i < m->name_count; i++) {
+        fprintf(out, "puncta_action_calls_total{action=\"");
+        const char *name = coc_str_data(m->names[i]);
+        for (size_t k = 0; k < coc_str_size(m->names[i]); k++) {
+            if (name[k] == '\\' || name[k] == '"') fputc('\\', out);
+            if (name[k] == '\n') fputs("\\n", out);
+            else fputc(name[k], out);
+        }
+        fprintf(out, "\"} %llu\n",
+                (unsigned long long)atomic_load_explicit(&m->published_calls[i], memory_order_relaxed));
+    }
+}
+
+// Writes PATH.tmp and renames it over PATH so that scrapers never see a
+// partial file. Returns 0 or errno.
+static inline int metrics_write_file(VM *vm, const char *path) {
+    Coc_String tmp = {0};
+    coc_str_append(&tmp, path);
+    coc_str_append(&tmp, ".tmp");
+    coc_str_append_null(&tmp);
+    const char *tmp_path = coc_str_data(&tmp);
+    int err = 0;
+    FILE *fp = fopen(tmp_path, "w");
+    if (fp == NULL) {
+        err = errno;
+    } else {
+        metrics_write_prometheus(vm, fp);
+        if (ferror(fp)) err = EIO;
+        if (fclose(fp) != 0 && err == 0) err = errno;
+        if (err == 0 && rename(tmp_path, path) != 0) err = errno;
+        if (err != 0) remove(tmp_path);
+    }
+    coc_str_free(&tmp);
+    return err;
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t metrics_wake_fd = -1;
+
+static void metrics_handler(int sig) {
+    COC_UNUSED(sig);
+    int saved = errno;
+    if (metrics_wake_fd >= 0) {
+        ssize_t written = write(metrics_wake_fd, "", 1);
+        COC_UNUSED(written);
+    }
+    errno = saved;
+}
+
+static void *metrics_main(void *arg) {
+    VM *vm = (VM *)arg;
+    Metrics *m = vm->metrics;
+    bool warned = false;
+    for (;;) {
+        struct pollfd pfd = {.fd = m->wake[0], .events = POLLIN};
+        if (poll(&pfd, 1, m->interval_ms > 0 ? m->interval_ms : -1) > 0) {
+            char buf[64];
+            while (read(m->wake[0], buf, sizeof(buf)) > 0);
+        }
+        if (atomic_load(&m->stop)) break;
+        int err = metrics_write_file(vm, m->path);
+        if (err != 0 && !warned) coc_log(COC_WARNING, "Cannot write metrics %s: %s", m->path, strerror(err));
+        warned = err != 0;
+    }
+    return NULL;
+}
+#endif // _WIN32
+
+// Starts counting. With a path, a background thread rewrites the file every
+// interval_ms milliseconds (never when 0) and whenever SIGUSR1 arrives.
+// Returns 0 or errno; counters work even when the exporter cannot start.
+static inline int metrics_start(VM *vm, const char *path, int interval_ms) {
+    Metrics *m = (Metrics *)COC_CALLOC(1, sizeof(Metrics));
+    if (m == NULL) return ENOMEM;
+    m->slots = (uint32_t *)COC_CALLOC(vm->module->prog.size + 1, sizeof(uint32_t));
+    LabelHashTable index = {0};
+    for (size_t pc = 0; pc < vm->module->prog.size; pc++) {
+        Instruction *inst = &vm->module->prog.items[pc];
+        if (inst->op != OP_ACT) continue;
+        int *slot = NULL;
+        coc_ht_find(&index, &inst->OperandB, slot);
+        if (slot == NULL) {
+            coc_ht_insert_copy(&index, &inst->OperandB, (int)m->name_count);
+            m->names = (Coc_String **)COC_REALLOC(m->names, (m->name_count + 1) * sizeof(Coc_String *));
+            m->names[m->name_count] = &inst->OperandB;
+            m->slots[pc] = (uint32_t)m->name_count++;
+        } else {
+            m->slots[pc] = (uint32_t)*slot;
+        }
+    }
+    coc_ht_free(&index);
+    m->calls           = (uint64_t *)COC_CALLOC(m->name_count + 1, sizeof(uint64_t));
+    m->published_calls = (_Atomic uint64_t *)COC_CALLOC(m->name_count + 1, sizeof(_Atomic uint64_t));
+    COC_ASSERT(m->slots != NULL && m->calls != NULL && m->published_calls != NULL);
+    m->path        = path;
+    m->interval_ms = interval_ms;
+    m->wake[0]     = m->wake[1] = -1;
+    atomic_store(&m->running, true);
+    vm->metrics = m;
+    metrics_publish(vm);
+    if (path == NULL) return 0;
+#ifndef _WIN32
+    if (pipe(m->wake) != 0) return errno;
+    fcntl(m->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(m->wake[1], F_SETFL, O_NONBLOCK);
+    sigset_t all, prev;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &prev);
+    int err = pthread_create(&m->thread, NULL, metrics_main, vm);
+    pthread_sigmask(SIG_SETMASK, &prev, NULL);
+    if (err != 0) return err;
+    m->has_thread = true;
+    metrics_wake_fd = m->wake[1];
+    struct sigaction sa = {0};
+    sa.sa_handler = metrics_handler;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGUSR1, &sa, NULL) < 0) return errno;
+    return 0;
+#else
+    return ENOSYS;
+#endif // _WIN32
+}
+
+// Publishes the final counts, writes the file one last time and frees
+static inline void metrics_stop(VM *vm) {
+    Metrics *m = vm->metrics;
+    if (m == NULL) return;
+    atomic_store(&m->running, false);
+    metrics_publish(vm);
+#ifndef _WIN32
+    if (m->has_thread) {
+        signal(SIGUSR1, SIG_DFL);
+        metrics_wake_fd = -1;
+        atomic_store(&m->stop, true);
+        ssize_t written = write(m->wake[1], "", 1);
+        COC_UNUSED(written);
+        pthread_join(m->thread, NULL);
+    }
+    if (m->wake[0] >= 0) close(m->wake[0]);
+    if (m->wake[1] >= 0) close(m->wake[1]);
+#endif // _WIN32
+    if (m->path != NULL) {
+        int err = metrics_write_file(vm, m->path);
+        if (err != 0) coc_log(COC_ERROR, "Cannot write metrics %s: %s", m->path, strerror(err));
+    }
+    COC_FREE(m->slots);
+    COC_FREE(m->calls);
+    COC_FREE(m->published_calls);
+    COC_FREE(m->names);
+    COC_FREE(m);
+    vm->metrics = NULL;
+}
+
+typedef struct RunOptions {
+    const char *emit_bytecode;
+    const char *profile_json;
+    const char *sample_output;
+    const char *stats_json;
+    const char *metrics;
+    bool        use_cache;
+    bool        profile;
+    bool        perf_counters;
+    bool        stats;
+    int         sample_hz;
+    int         metrics_interval_ms;
+    int         jobs;                 // run_batch_opts() threads, 0: one per CPU
+    uint64_t    max_instructions;     // 0: no limit
+    int         timeout_ms;           // 0: no limit
+} RunOptions;
+
+static inline PunctaStatus run_vm_opts(VM *vm, const char *filename, const RunOptions *opts) {
+    vm_set_limits(vm, opts->max_instructions, opts->timeout_ms);
+    if (opts->metrics != NULL) {
+        int err = metrics_start(vm, opts->metrics, opts->metrics_interval_ms);
+        if (err != 0) coc_log(COC_WARNING, "Cannot start metrics exporter: %s", strerror(err));
+    }
+    Sampler sampler = {0};
+    if (opts->sample_hz > 0) {
+        int err = sample_start(vm, &sampler, opts->sample_hz);
+        if (err != 0) {
+            coc_log(COC_WARNING, "Cannot start sampling profiler: %s", strerror(err));
+            sample_stop(&sampler);
+            sample_free(&sampler);
+        }
+    }
+    PerfMark mark;
+    PunctaStatus status = PUNCTA_OK;
+    if (opts->profile || opts->profile_json != NULL) {
+        Profile prof = {0};
+        profile_start(vm, &prof);
+        perf_phase_begin(&mark);
+        status = vm_run(vm);
+        perf_phase_end(PHASE_RUN, &mark);
+        profile_stop(vm);
+        fflush(vm->out);
+        if (opts->profile) profile_report(vm, &prof, stderr);
+        if (opts->profile_json != NULL) {
+            int err = profile_write_json(vm, &prof, opts->profile_json);
+            if (err != 0) coc_log(COC_ERROR, "Cannot write profile %s: %s", opts->profile_json, strerror(err));
+        }
+        profile_free(&prof);
+    } else {
+        perf_phase_begin(&mark);
+        status = vm_run(vm);
+        perf_phase_end(PHASE_RUN, &mark);
+    }
+    if (vm->metrics != NULL) {
+        fflush(vm->out);
+        metrics_stop(vm);
+    }
+    if (sampler.counts != NULL) {
+        sample_stop(&sampler);
+        Coc_String path = {0};
+        coc_str_append(&path, opts->sample_output != NULL ? opts->sample_output : filename);
+        if (opts->sample_output == NULL) coc_str_append(&path, ".folded");
+        coc_str_append_null(&path);
+        const char *out = coc_str_data(&path);
+        int err = sample_write_folded(vm, &sampler, filename, out);
+        if (err != 0) coc_log(COC_ERROR, "Cannot write samples %s: %s", out, strerror(err));
+        else coc_log(COC_INFO, "%llu samples at %d Hz written to %s",
+                     (unsigned long long)sampler.total, sampler.hz, out);
+        coc_str_free(&path);
+        sample_free(&sampler);
+    }
+    return status;
+}
+
+// Bytecode, the bytecode cache or the source, whichever applies
+static inline VM *load_file(const char *filename, bool use_cache) {
+    if (bytecode_is_file(filename)) return bytecode_load(filename);
+    if (use_cache) return compile_file_cached(filename);
+    return compile_file(filename);
+}
+
+static inline VM *run_file_opts(const char *filename, void (*register_user_actions)(VM *), const RunOptions *opts) {
+    RunOptions defaults = {0};
+    if (opts == NULL) opts = &defaults;
+    PerfCounters perf = {0};
+    if (opts->perf_counters) {
+        if (perf_open(&perf) == 0)
+            coc_log(COC_WARNING, "Hardware performance counters are unavailable, only timings will be reported");
+    } else {
+        perf_init(&perf);
+    }
+    bool stats = opts->stats || opts->stats_json != NULL;
+    if (opts->perf_counters || stats) {
+        perf.time_lexer = stats;
+        perf_counters = &perf;
+    }
+    if (stats) coc_global_heap.enabled = true;
+    PunctaStatus status = PUNCTA_OK;
+    VM *vm = load_file(filename, opts->use_cache);
+    if (vm != NULL && opts->emit_bytecode != NULL) {
+        int err = bytecode_save(vm, opts->emit_bytecode, NULL);
+        if (err != 0) {
+            coc_log(COC_ERROR, "Cannot write bytecode file %s: %s", opts->emit_bytecode, strerror(err));
+            vm_free(vm);
+            vm = NULL;
+        }
+    } else if (vm != NULL) {
+        if (register_user_actions != NULL) {
+            coc_log(COC_DEBUG, "Register user actions");
+            PerfMark mark;
+            perf_phase_begin(&mark);
+            register_user_actions(vm);
+            perf_phase_end(PHASE_REGISTER, &mark);
+        }
+        status = run_vm_opts(vm, filename, opts);
+    }
+    perf_counters = NULL;
+    if (opts->perf_counters || stats) fflush(stdout);
+    if (opts->perf_counters) perf_report(&perf, vm != NULL ? vm->steps : 0, stderr);
+    if (opts->stats) stats_report(vm, &perf, stderr);
+    if (opts->stats_json != NULL) {
+        int err = stats_write_json(vm, &perf, opts->stats_json);
+        if (err != 0) coc_log(COC_ERROR, "Cannot write stats %s: %s", opts->stats_json, strerror(err));
+    }
+    perf_close(&perf);
+    if (status != PUNCTA_OK) {
+        vm_free(vm);
+        vm = NULL;
+    }
+    return vm;
+}
+
+static inline VM *run_file(const char *filename, void (*register_user_actions)(VM *)) {
+    return run_file_opts(filename, register_user_actions, NULL);
+}
+
+// Streaming mode: the program is read from a file descriptor, a pipe for
+// instance, and parsed a few statements at a time while it runs. More is
+// read only when the VM runs past the end of what has been parsed, or
+// takes a jump to a label that has not been seen yet; a label that never
+// shows up is an error once the input ends. A jump is resolved the first
+// time it is taken, so a label defined twice keeps the position it had
+// then. Instructions already run are dropped unless a label may lead back
+// to them, which keeps straight-line programs in bounded memory.
+#ifndef _WIN32
+
+#define STREAM_READ_SIZE   65536
+#define STREAM_COMPACT_MIN 4096 // fewer dropped instructions are not worth moving the rest
+
+typedef struct PunctaStream {
+    VM        *vm;          // runs module, takes user actions and I/O before stream_run()
+    Module     module;      // a view of the program and labels owned by parser
+    Parser     parser;
+    char      *text;        // read but not parsed yet
+    size_t     size;
+    size_t     capacity;
+    size_t     scanned;     // text[0, scanned) has been scanned for statement ends
+    size_t     cut;         // text[0, cut) holds whole statements
+    int        line;        // line number of text[0]
+    int        scan_line;   // line number at text[scanned]
+    int        cut_line;    // line number at text[cut]
+    int        depth;       // comment nesting at text[scanned]
+    bool       in_string;
+    bool       eof;
+    int        fd;
+    size_t     label_count; // labels when label_floor was found
+    int        label_floor; // lowest label position
+} PunctaStream;
+
+static inline PunctaStream *stream_open(int fd) {
+    PunctaStream *s = (PunctaStream *)COC_CALLOC(1, sizeof(PunctaStream));
+    if (s == NULL) {
+        puncta_raise(PUNCTA_ERR_MEMORY, 0, "Stream open: calloc() failed");
+    }
+    s->fd = fd;
+    s->line = s->scan_line = s->cut_line = 1;
+    s->vm = vm_new(&s->module);
+    return s;
+}
+
+static inline void stream_free(PunctaStream *s) {
+    Program *prog = &s->parser.instructions;
+    for (size_t i = 0; i < prog->size; i++) {
+        coc_str_free(&prog->items[i].OperandA);
+        coc_str_free(&prog->items[i].OperandB);
+        coc_str_free(&prog->items[i].Label);
+    }
+    coc_vec_free(prog);
+    coc_ht_free(&s->parser.labels);
+    vm_free(s->vm);
+    COC_FREE(s->text);
+    COC_FREE(s);
+}
+
+static inline void stream_sync(PunctaStream *s) {
+    s->module.prog   = s->parser.instructions;
+    s->module.labels = s->parser.labels;
+}
+
+// Moves cut past every statement known to be whole: one ending in '.', ';'
+// or ':' before a blank or an identifier, or in '!' before an identifier
+// (an '@' would still belong to it). A statement end whose next character
+// has not been read yet is scanned again after the next read.
+static inline void stream_scan(PunctaStream *s) {
+    const char *src = s->text;
+    size_t i = s->scanned;
+    for (; i < s->size; i++) {
+        char c = src[i];
+        if (c == '\n') {
+            s->scan_line++;
+            s->in_string = false; // a lexical error, the parser reports it
+            continue;
+        }
+        if (s->in_string) {
+            if (c == '\\') {
+                if (i + 1 == s->size) break;
+                i++;
+            } else if (c == '"') {
+                s->in_string = false;
+            }
+            continue;
+        }
+        if (s->depth > 0) {
+            if (c == '(') s->depth++;
+            else if (c == ')') s->depth--;
+            continue;
+        }
+        if (c == '"') s->in_string = true;
+        else if (c == '(') s->depth = 1;
+        else if (c == '.' || c == '!' || c == ';' || c == ':') {
+            size_t j = i + 1;
+            if (c == '!') {
+                while (j < s->size && isspace((unsigned char)src[j])) j++;
+            }
+            if (j == s->size) break;
+            unsigned char next = (unsigned char)src[j];
+            if (isalpha(next) || next == '_' || (c != '!' && isspace(next))) {
+                s->cut      = i + 1;
+                s->cut_line = s->scan_line;
+            }
+        }
+    }
+    s->scanned = i;
+}
+
+// Parses text[0, cut) onto the program and drops it from text
+static inline void stream_parse(PunctaStream *s) {
+    size_t from = s->parser.instructions.size;
+    Lexer lex = {
+        .src  = {.items = s->text, .size = s->cut, .capacity = s->cut, .not_sso = true},
+        .line = s->line
+    };
+    s->parser.lex     = &lex;
+    s->parser.cur_tok = parser_lex(&lex);
+    while (s->parser.cur_tok.kind != tok_eof) parse_statement(&s->parser);
+    s->parser.lex = NULL;
+    memmove(s->text, s->text + s->cut, s->size - s->cut);
+    s->size    -= s->cut;
+    s->scanned -= s->cut;
+    s->line     = s->cut_line;
+    s->cut      = 0;
+    stream_sync(s);
+    module_freeze_from(&s->module, from);
+}
+
+// Reads until at least one more statement is whole and parses what is.
+// Returns false once the input has ended and all of it has been parsed.
+static inline bool stream_more(PunctaStream *s) {
+    while (s->cut == 0 && !s->eof) {
+        if (s->capacity - s->size < STREAM_READ_SIZE) {
+            size_t cap = s->capacity == 0 ? STREAM_READ_SIZE * 2 : s->capacity * 2;
+            char *text = (char *)COC_REALLOC(s->text, cap);
+            if (text == NULL) {
+                puncta_raise(PUNCTA_ERR_MEMORY, 0, "Stream read: realloc() failed");
+            }
+            s->text     = text;
+            s->capacity = cap;
+        }
+        // The output so far shows before waiting for the rest of the program
+        fflush(s->vm->out);
+        ssize_t n = read(s->fd, s->text + s->size, s->capacity - s->size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            puncta_raise(PUNCTA_ERR_IO, s->line, "Stream error: read() failed: %s", strerror(errno));
+        }
+        if (n == 0) {
+            s->eof = true;
+            s->cut = s->size;
+            break;
+        }
+        s->size += (size_t)n;
+        stream_scan(s);
+    }
+    if (s->cut == 0) return false;
+    stream_parse(s);
+    return true;
+}
+
+// Drops the instructions before vm->pc that no label or return address
+// leads back to, once there are enough of them to be worth moving the rest
+static inline void stream_compact(PunctaStream *s) {
+    VM *vm = s->vm;
+    Program *prog = &s->parser.instructions;
+    LabelHashTable *labels = &s->parser.labels;
+    size_t keep = (size_t)vm->pc;
+    if (labels->size > 0) {
+        if (labels->size != s->label_count) {
+            s->label_floor = INT_MAX;
+            for (size_t i = 0; i < labels->capacity; i++) {
+                LabelEntry *e = &labels->items[i];
+                if (e->is_used && e->value < s->label_floor) s->label_floor = e->value;
+            }
+            s->label_count = labels->size;
+        }
+        if ((size_t)s->label_floor < keep) keep = (size_t)s->label_floor;
+    }
+    for (int i = 0; i < vm->call_depth; i++) {
+        if ((size_t)vm->calls[i] < keep) keep = (size_t)vm->calls[i];
+    }
+    if (keep < STREAM_COMPACT_MIN || keep < prog->size / 2) return;
+    for (size_t i = 0; i < keep; i++) {
+        coc_str_free(&prog->items[i].OperandA);
+        coc_str_free(&prog->items[i].OperandB);
+        coc_str_free(&prog->items[i].Label);
+    }
+    prog->size -= keep;
+    memmove(prog->items, prog->items + keep, prog->size * sizeof(Instruction));
+    for (size_t i = 0; i < prog->size; i++) {
+        Instruction *inst = &prog->items[i];
+        if ((inst->op == OP_JMP || inst->op == OP_JEQ || inst->op == OP_CALL) && inst->target >= 0) inst->target -= (int)keep;
+    }
+    for (size_t i = 0; i < labels->capacity; i++) {
+        if (labels->items[i].is_used) labels->items[i].value -= (int)keep;
+    }
+    if (labels->size > 0) s->label_floor -= (int)keep;
+    for (int i = 0; i < vm->call_depth; i++) vm->calls[i] -= (int)keep;
+    vm->pc -= (int)keep;
+    stream_sync(s);
+}
+
+// Takes the jump at pc, reading on while its label has not shown up
+static inline void stream_jump(PunctaStream *s, int pc) {
+    VM *vm = s->vm;
+    Instruction *inst = &s->module.prog.items[pc];
+    while (inst->target < 0) {
+        int *pos = NULL;
+        coc_ht_find(&s->module.labels, &inst->Label, pos);
+        if (pos != NULL) {
+            inst->target = *pos;
+            break;
+        }
+        bool more = stream_more(s);
+        inst = &s->module.prog.items[pc];
+        if (!more) {
+            puncta_raise(PUNCTA_ERR_SEMANTIC, inst->line,
+                    "Semantic error at line %d: label '%.*s' not defined",
+                    inst->line, (int)coc_str_size(&inst->Label), coc_str_data(&inst->Label));
+        }
+    }
+    vm->pc = inst->target;
+}
+
+// run() over a program that grows as it is read
+static inline void run_stream(PunctaStream *s) {
+    VM *vm = s->vm;
+    uint64_t steps = 0, jumps = 0, batch = METRICS_BATCH;
+    while (true) {
+        if (vm->pc >= (int)s->module.prog.size) {
+            stream_compact(s);
+            if (!stream_more(s)) break;
+            continue;
+        }
+        int pc = vm->pc;
+        Instruction *inst = &s->module.prog.items[pc];
+        switch (inst->op) {
+        case OP_ASSIGN: vm_assign(vm, inst); break;
+        case OP_ACT:
+            vm_check_limits(vm, steps);
+            vm_hand_over_counters(vm, &steps, &jumps, &batch);
+            vm_act(vm, inst);
+            break;
+        case OP_JEQ:
+            if (!vm_jeq_cond(vm, inst)) {
+                vm->pc++;
+                break;
+            }
+            stream_jump(s, pc);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_JMP:
+            stream_jump(s, pc);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_CALL:
+            vm_push_return(vm);
+            stream_jump(s, pc);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_RET:
+            vm_ret(vm);
+            jumps++;
+            vm_check_loop(vm, pc, steps);
+            break;
+        case OP_END:    vm->pc++; break;
+        }
+        if (COC_UNLIKELY(++steps == batch)) {
+            vm_flush_counters(vm, steps, jumps);
+            steps = jumps = 0;
+            batch = METRICS_BATCH;
+        }
+    }
+    vm_flush_counters(vm, steps, jumps);
+}
+
+// vm_run() for a stream: reads, parses and runs until the input ends or
+// something fails. Syntax errors stop the run where they are reached.
+static inline PunctaStatus stream_run(PunctaStream *s) {
+    VM *vm = s->vm;
+    Coc_Log_Config *prev_log = coc_log_use(vm->log != NULL ? vm->log : coc_thread_log_config);
+    vm->error = (PunctaError){0};
+    PunctaTrap trap;
+    puncta_trap_push(&trap, &vm->error);
+    if (setjmp(trap.env) != 0) {
+        coc_log_use(prev_log);
+        return vm->error.status;
+    }
+    run_stream(s);
+    puncta_trap_pop(&trap);
+    coc_log_use(prev_log);
+    return PUNCTA_OK;
+}
+
+// Runs the program in filename ("-": stdin) as it is read
+static inline PunctaStatus run_stream_opts(const char *filename, void (*register_user_actions)(VM *), const RunOptions *opts) {
+    RunOptions defaults = {0};
+    if (opts == NULL) opts = &defaults;
+    bool is_stdin = strcmp(filename, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0) {
+        coc_log(COC_FATAL, "Cannot open %s: %s", filename, strerror(errno));
+        return PUNCTA_ERR_IO;
+    }
+    PunctaStream *s = stream_open(fd);
+    if (register_user_actions != NULL) register_user_actions(s->vm);
+    vm_set_limits(s->vm, opts->max_instructions, opts->timeout_ms);
+    PunctaStatus status = stream_run(s);
+    fflush(s->vm->out);
+    coc_log(COC_DEBUG, "Stream %s: %llu instructions run, %zu kept", filename,
+            (unsigned long long)s->vm->steps, s->module.prog.size);
+    stream_free(s);
+    if (!is_stdin) close(fd);
+    return status;
+}
+
+#endif // _WIN32
+
+// Batch mode: the program is compiled once and run once per input file,
+// one VM on the shared module per input, reading the input as its stdin. The outputs
+// are collected in memory and written to stdout in the order of the list.
+//
+// Every worker owns a deque of inputs, an arithmetic progression of list
+// indices: worker w starts with w, w + jobs, w + 2 * jobs, ... so that the
+// head of the list finishes first and can be written out early. A worker
+// takes from the front of its own deque and, once it is empty, steals the
+// back half of the fullest one. Each job is a whole program run, so a lock
+// per deque costs nothing next to it.
+#ifndef _WIN32
+
+typedef struct BatchJob {
+    const char   *input;
+    char         *output;
+    size_t        size;
+    PunctaStatus  status;
+    bool          done;
+} BatchJob;
+
+typedef struct BatchDeque {
+    pthread_mutex_t lock;
+    size_t          base;   // job index = base + i * stride, head <= i < tail
+    size_t          stride;
+    size_t          head;
+    size_t          tail;
+} BatchDeque;
+
+typedef struct Batch {
+    VM              *code;
+    void           (*register_user_actions)(VM *);
+    const RunOptions *opts;
+    BatchJob        *jobs;
+    size_t           job_count;
+    BatchDeque      *deques;
+    int              worker_count;
+    pthread_mutex_t  lock;  // guards BatchJob.done
+    pthread_cond_t   done;
+} Batch;
+
+typedef struct BatchWorker {
+    Batch *batch;
+    int    id;
+} BatchWorker;
+
+static inline bool batch_pop(BatchDeque *d, size_t *job) {
+    pthread_mutex_lock(&d->lock);
+    bool ok = d->head < d->tail;
+    if (ok) *job = d->base + d->head++ * d->stride;
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+// Moves the back half of the fullest other deque into self. Only its owner
+// refills a deque, and only when it is empty, so one lock is held at a time.
+static inline bool batch_steal(Batch *b, int self) {
+    while (true) {
+        int victim = -1;
+        size_t most = 0;
+        for (int i = 0; i < b->worker_count; i++) {
+            BatchDeque *d = &b->deques[i];
+            pthread_mutex_lock(&d->lock);
+            size_t left = d->tail - d->head;
+            pthread_mutex_unlock(&d->lock);
+            if (i != self && left > most) {
+                most   = left;
+                victim = i;
+            }
+        }
+        if (victim < 0) return false;
+        BatchDeque *from = &b->deques[victim], *to = &b->deques[self];
+        pthread_mutex_lock(&from->lock);
+        size_t left = from->tail - from->head;
+        if (left == 0) {
+            // Drained since the scan, look again
+            pthread_mutex_unlock(&from->lock);
+            continue;
+        }
+        BatchDeque stolen = {.base = from->base, .stride = from->stride,
+                             .head = from->tail - (left + 1) / 2, .tail = from->tail};
+        from->tail = stolen.head;
+        pthread_mutex_unlock(&from->lock);
+        pthread_mutex_lock(&to->lock);
+        to->base   = stolen.base;
+        to->stride = stolen.stride;
+        to->head   = stolen.head;
+        to->tail   = stolen.tail;
+        pthread_mutex_unlock(&to->lock);
+        return true;
+    }
+}
+
+static inline void batch_run_job(Batch *b, BatchJob *job) {
+    FILE *out = open_memstream(&job->output, &job->size);
+    FILE *in  = fopen(job->input, "rb");
+    if (out == NULL || in == NULL) {
+        coc_log(COC_ERROR, "Cannot open input %s: %s", job->input, strerror(errno));
+        job->status = PUNCTA_ERR_IO;
+    } else {
+        VM *vm = vm_new(b->code->module);
+        vm_set_io(vm, in, out);
+        vm_set_limits(vm, b->opts->max_instructions, b->opts->timeout_ms);
+        if (b->register_user_actions != NULL) b->register_user_actions(vm);
+        job->status = vm_run(vm);
+        if (job->status != PUNCTA_OK)
+            coc_log(COC_ERROR, "Input %s failed: %s error", job->input, puncta_status_name(job->status));
+        vm_free(vm);
+    }
+    if (in != NULL) fclose(in);
+    if (out != NULL) fclose(out);
+}
+
+static inline void *batch_main(void *arg) {
+    BatchWorker *w = (BatchWorker *)arg;
+    Batch *b = w->batch;
+    size_t index;
+    while (batch_pop(&b->deques[w->id], &index) || (batch_steal(b, w->id) && batch_pop(&b->deques[w->id], &index))) {
+        BatchJob *job = &b->jobs[index];
+        batch_run_job(b, job);
+        pthread_mutex_lock(&b->lock);
+        job->done = true;
+        pthread_cond_signal(&b->done);
+        pthread_mutex_unlock(&b->lock);
+    }
+    return NULL;
+}
+
+// One input path per line; empty lines are skipped
+static inline int batch_read_list(const char *path, Coc_String *text, BatchJob **jobs, size_t *count) {
+    int err = coc_read_entire_file(path, text);
+    if (err != 0) return err;
+    coc_str_append_null(text);
+    size_t cap = 0;
+    for (char *line = coc_str_data(text), *next; line != NULL && *line != '\0'; line = next) {
+        next = strchr(line, '\n');
+        if (next != NULL) *next++ = '\0';
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+        if (len == 0) continue;
+        if (*count == cap) {
+            cap = cap == 0 ? COC_VEC_INIT_CAP : cap * 2;
+            *jobs = (BatchJob *)COC_REALLOC(*jobs, cap * sizeof(BatchJob));
+            COC_ASSERT(*jobs != NULL);
+        }
+        (*jobs)[(*count)++] = (BatchJob){.input = line};
+    }
+    return 0;
+}
+
+// Returns the number of inputs that failed, or -1 when the program or the
+// list cannot be loaded
+static inline int run_batch_opts(const char *filename, const char *list, void (*register_user_actions)(VM *), const RunOptions *opts) {
+    RunOptions defaults = {0};
+    if (opts == NULL) opts = &defaults;
+    Coc_String text = {0};
+    Batch b = {.register_user_actions = register_user_actions, .opts = opts};
+    int err = batch_read_list(list, &text, &b.jobs, &b.job_count);
+    if (err != 0) {
+        coc_str_free(&text);
+        return -1;
+    }
+    b.code = load_file(filename, opts->use_cache);
+    if (b.code == NULL) {
+        COC_FREE(b.jobs);
+        coc_str_free(&text);
+        return -1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    b.worker_count = opts->jobs > 0 ? opts->jobs : (cpus > 0 ? (int)cpus : 1);
+    if ((size_t)b.worker_count > b.job_count) b.worker_count = b.job_count > 0 ? (int)b.job_count : 1;
+    coc_log(COC_DEBUG, "Batch: %zu inputs on %d threads", b.job_count, b.worker_count);
+    b.deques = (BatchDeque *)COC_CALLOC(b.worker_count, sizeof(BatchDeque));
+    BatchWorker *workers = (BatchWorker *)COC_CALLOC(b.worker_count, sizeof(BatchWorker));
+    pthread_t *threads = (pthread_t *)COC_CALLOC(b.worker_count, sizeof(pthread_t));
+    COC_ASSERT(b.deques != NULL && workers != NULL && threads != NULL);
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.done, NULL);
+    size_t stride = (size_t)b.worker_count;
+    for (int i = 0; i < b.worker_count; i++) {
+        BatchDeque *d = &b.deques[i];
+        pthread_mutex_init(&d->lock, NULL);
+        d->base   = (size_t)i;
+        d->stride = stride;
+        d->tail   = b.job_count > (size_t)i ? (b.job_count - i + stride - 1) / stride : 0;
+        workers[i] = (BatchWorker){.batch = &b, .id = i};
+    }
+    int started = 0;
+    for (; started < b.worker_count; started++) {
+        err = pthread_create(&threads[started], NULL, batch_main, &workers[started]);
+        if (err != 0) {
+            coc_log(COC_WARNING, "Cannot start batch thread: %s", strerror(err));
+            break;
+        }
+    }
+    // Without a single thread the inputs are run here, the stealing works the same
+    if (started == 0) batch_main(&workers[0]);
+
+    int failed = 0;
+    for (size_t i = 0; i < b.job_count; i++) {
+        BatchJob *job = &b.jobs[i];
+        pthread_mutex_lock(&b.lock);
+        while (!job->done) pthread_cond_wait(&b.done, &b.lock);
+        pthread_mutex_unlock(&b.lock);
+        if (job->size > 0) fwrite(job->output, 1, job->size, stdout);
+        free(job->output);
+        failed += job->status != PUNCTA_OK;
+    }
+    fflush(stdout);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    for (int i = 0; i < b.worker_count; i++) pthread_mutex_destroy(&b.deques[i].lock);
+    pthread_cond_destroy(&b.done);
+    pthread_mutex_destroy(&b.lock);
+    COC_FREE(threads);
+    COC_FREE(workers);
+    COC_FREE(b.deques);
+    COC_FREE(b.jobs);
+    coc_str_free(&text);
+    vm_free(b.code);
+    return failed;
+}
+
+// Serve mode: a daemon that keeps compiled modules and runs requests sent
+// over a Unix domain socket. A client passes its own stdin, stdout and
+// stderr with the request (SCM_RIGHTS), so the program writes them directly
+// and output streams as it is produced. Input may be interactive: the
+// worker passes it on through a pipe as the program asks for it, waiting
+// on the client's stdin and its own wake pipe, so that a cancel also stops
+// a run blocked on input. Modules are cached by path, trusted while size
+// and change time (to the nanosecond, and set by every write or touch)
+// match, and otherwise reused when the 128-bit content digest matches.
+// Every request runs on a fresh VM over the cached module (one small
+// allocation) on one of a fixed pool of threads. The accepting thread also
+// watches the connections of running requests: a client that goes away
+// cancels its run, and so does shutdown.
+
+#define SERVE_MAGIC    0x51554e50u // "PUNQ"
+#define SERVE_PATH_MAX 4096
+#define SERVE_QUEUE    64          // accepted connections waiting for a thread
+#define SERVE_TIMEOUT_MS 60000     // per request, when the server has no --timeout
+#define SERVE_INPUT_CHUNK 4096     // bytes passed on per wait for input, fits any pipe
+
+typedef struct ServeRequest {
+    uint32_t magic;
+    uint16_t puncta_major;
+    uint16_t puncta_minor;
+    uint16_t puncta_patch;
+    uint16_t path_len;
+    int32_t  timeout_ms;
+    uint64_t max_instructions;
+    int32_t  log_level;
+    bool     log_date;
+    bool     log_time;
+    bool     log_ms;
+    bool     log_color;
+} ServeRequest;
+
+typedef struct ServeModule {
+    VM           *code;    // owns the module
+    uint64_t      size;
+    int64_t       ctime_ns;
+    SourceDigest  digest;
+    int           refs;    // running requests, plus one while cached
+} ServeModule;
+
+typedef struct ServeEntry {
+    Coc_String   key;
+    ServeModule *value;
+    bool         is_used;
+} ServeEntry;
+
+typedef struct ServeTable {
+    ServeEntry *items;
+    ServeEntry *new_items;
+    uint8_t    *ctrl;
+    size_t      size;
+    size_t      tombstones;
+    size_t      capacity;
+} ServeTable;
+
+typedef struct Serve Serve;
+
+typedef struct ServeWorker {
+    Serve       *s;
+    pthread_t    thread;
+    int          conn;     // connection of the running request, -1 when idle
+    atomic_bool  cancel;   // the cancel flag of its VM
+    int          wake[2];  // self-pipe: serve_cancel() wakes a wait for input
+} ServeWorker;
+
+struct Serve {
+    ServeTable        modules;
+    const RunOptions *opts;
+    void            (*register_user_actions)(VM *);
+    int               timeout_ms;
+    pthread_mutex_t   lock;   // guards modules, ServeModule.refs, the queue and ServeWorker.conn
+    pthread_cond_t    ready;
+    pthread_cond_t    room;
+    int               queue[SERVE_QUEUE];
+    size_t            head;
+    size_t            count;
+    bool              stop;
+    ServeWorker      *workers;
+    int               worker_count;
+    int               wake[2];  // self-pipe: a worker started a run, watch its connection
+};
+
+static volatile sig_atomic_t serve_interrupted = 0;
+
+static inline void serve_on_signal(int sig) {
+    COC_UNUSED(sig);
+    serve_interrupted = 1;
+}
+
+static inline bool serve_write_all(int fd, const void *data, size_t size) {
+    const char *p = (const char *)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p    += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static inline bool serve_read_all(int fd, void *data, size_t size) {
+    char *p = (char *)data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p    += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static inline int serve_address(const char *path, struct sockaddr_un *addr) {
+    *addr = (struct sockaddr_un){.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr->sun_path)) return ENAMETOOLONG;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+static inline void serve_module_release(Serve *s, ServeModule *m) {
+    pthread_mutex_lock(&s->lock);
+    bool last = --m->refs == 0;
+    pthread_mutex_unlock(&s->lock);
+    if (last) {
+        vm_free(m->code);
+        COC_FREE(m);
+    }
+}
+
+// The cached module of path with one reference for the caller, compiled or
+// loaded again when the file changed. NULL when it cannot be built: the
+// error has been logged to the client and puncta_last_error() tells which.
+static inline ServeModule *serve_module_get(Serve *s, const char *path) {
+    Coc_String key = {0};
+    coc_str_append(&key, path);
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        coc_log(COC_FATAL, "Cannot read file %s: %s", path, strerror(errno));
+        puncta_error = (PunctaError){.status = PUNCTA_ERR_IO};
+        coc_str_free(&key);
+        return NULL;
+    }
+    pthread_mutex_lock(&s->lock);
+    ServeModule **found = NULL;
+    coc_ht_find(&s->modules, &key, found);
+    ServeModule *m = found != NULL ? *found : NULL;
+    if (m != NULL && m->size == (uint64_t)st.st_size && m->ctime_ns == stat_ctime_ns(&st)) {
+        m->refs++;
+        pthread_mutex_unlock(&s->lock);
+        coc_str_free(&key);
+        return m;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    Coc_String source = {0};
+    if (coc_read_entire_file(path, &source) != 0) {
+        puncta_error = (PunctaError){.status = PUNCTA_ERR_IO};
+        coc_str_free(&key);
+        return NULL;
+    }
+    SourceDigest digest = source_digest(&source);
+    pthread_mutex_lock(&s->lock);
+    coc_ht_find(&s->modules, &key, found);
+    m = found != NULL ? *found : NULL;
+    if (m != NULL && m->size == (uint64_t)st.st_size && source_digest_equal(m->digest, digest)) {
+        // Touched, not changed
+        m->ctime_ns = stat_ctime_ns(&st);
+        m->refs++;
+        pthread_mutex_unlock(&s->lock);
+        coc_str_free(&source);
+        coc_str_free(&key);
+        return m;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    // Compiled outside of the lock: other requests keep running meanwhile
+    VM *code = NULL;
+    if (bytecode_is_file(path)) {
+        coc_str_free(&source);
+        code = bytecode_load(path);
+        if (code == NULL) puncta_error = (PunctaError){.status = PUNCTA_ERR_IO};
+    } else {
+        code = compile_source(source);
+    }
+    if (code == NULL) {
+        coc_str_free(&key);
+        return NULL;
+    }
+    m = (ServeModule *)COC_MALLOC(sizeof(ServeModule));
+    COC_ASSERT(m != NULL);
+    *m = (ServeModule){.code = code, .size = (uint64_t)st.st_size, .ctime_ns = stat_ctime_ns(&st),
+                       .digest = digest, .refs = 2};
+    coc_log(COC_DEBUG, "Serve: compiled %s", path);
+    pthread_mutex_lock(&s->lock);
+    ServeModule *old = NULL;
+    coc_ht_find(&s->modules, &key, found);
+    if (found != NULL) old = *found;
+    coc_ht_insert_move(&s->modules, &key, m);
+    pthread_mutex_unlock(&s->lock);
+    if (old != NULL) serve_module_release(s, old);
+    return m;
+}
+
+// Takes the three descriptors of the client with the request
+static inline bool serve_recv_request(int conn, ServeRequest *req, int fds[3]) {
+    union {
+        char           buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {.iov_base = req, .iov_len = sizeof(*req)};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1,
+                         .msg_control = control.buf, .msg_controllen = sizeof(control.buf)};
+    ssize_t n;
+    do n = recvmsg(conn, &msg, 0); while (n < 0 && errno == EINTR);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int))) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    if (n != (ssize_t)sizeof(*req) || req->magic != SERVE_MAGIC ||
+        req->puncta_major != PUNCTA_VERSION_MAJOR || req->puncta_minor != PUNCTA_VERSION_MINOR ||
+        req->puncta_patch != PUNCTA_VERSION_PATCH || req->path_len == 0 || req->path_len >= SERVE_PATH_MAX) {
+        for (int i = 0; i < 3; i++) close(fds[i]);
+        return false;
+    }
+    return true;
+}
+
+// The tighter of two limits, 0 meaning none
+static inline uint64_t serve_limit(uint64_t a, uint64_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    return a < b ? a : b;
+}
+
+// Stops the run of w at its next limit check or wait for input. Called
+// with the lock held.
+static inline void serve_cancel(ServeWorker *w) {
+    atomic_store(&w->cancel, true);
+    ssize_t written = write(w->wake[1], "", 1);
+    COC_UNUSED(written);
+}
+
+// Hands conn to the accepting thread while w runs a request on it, or
+// takes it back with conn = -1
+static inline void serve_watch(ServeWorker *w, int conn) {
+    Serve *s = w->s;
+    pthread_mutex_lock(&s->lock);
+    w->conn = conn;
+    if (conn >= 0) {
+        char buf[64];
+        while (read(w->wake[0], buf, sizeof(buf)) > 0);
+        atomic_store(&w->cancel, false);
+        if (s->stop) serve_cancel(w);
+    }
+    pthread_mutex_unlock(&s->lock);
+    if (conn >= 0) {
+        ssize_t written = write(s->wake[1], "", 1);
+        COC_UNUSED(written);
+    }
+}
+
+// Waits until the client's stdin (from) has data or the run of w is
+// cancelled, and passes up to SERVE_INPUT_CHUNK bytes on to the input
+// pipe of the VM, which is empty since the VM is waiting. At the end of
+// the client's input, and on a cancel, the pipe is closed (*to = -1):
+// the VM then sees the end of its input, and a cancelled one stops.
+static inline void serve_feed_input(ServeWorker *w, int from, int *to) {
+    struct pollfd pfds[2] = {{.fd = from, .events = POLLIN}, {.fd = w->wake[0], .events = POLLIN}};
+    while (!atomic_load(&w->cancel)) {
+        if (poll(pfds, 2, -1) < 0 && errno != EINTR) break;
+        if (pfds[0].revents == 0) continue;
+        char buf[SERVE_INPUT_CHUNK];
+        ssize_t n = read(from, buf, sizeof(buf));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n > 0 && serve_write_all(*to, buf, (size_t)n)) return;
+        break;
+    }
+    close(*to);
+    *to = -1;
+}
+
+static inline void serve_handle(ServeWorker *w, int conn) {
+    Serve *s = w->s;
+    ServeRequest req;
+    int fds[3];
+    char path[SERVE_PATH_MAX];
+    if (!serve_recv_request(conn, &req, fds)) {
+        coc_log(COC_WARNING, "Serve: dropped a malformed request");
+        return;
+    }
+    if (!serve_read_all(conn, path, req.path_len)) {
+        for (int i = 0; i < 3; i++) close(fds[i]);
+        return;
+    }
+    path[req.path_len] = '\0';
+    // The VM reads a pipe of its own, never blocking: O_NONBLOCK on the
+    // client's stdin would be seen by every process sharing it
+    int feed[2] = {-1, -1};
+    FILE *in = NULL;
+    if (pipe(feed) == 0) {
+        fcntl(feed[0], F_SETFL, O_NONBLOCK);
+        in = fdopen(feed[0], "rb");
+    }
+    FILE *out = fdopen(fds[1], "wb");
+    FILE *err = fdopen(fds[2], "wb");
+    int32_t status = PUNCTA_ERR_IO;
+    if (in != NULL && out != NULL && err != NULL) {
+        // Messages of this request go to the stderr of its client
+        Coc_Log_Config log = {
+            .min_level = (Coc_Log_Level)req.log_level,
+            .use_date  = req.log_date,
+            .use_time  = req.log_time,
+            .use_ms    = req.log_ms,
+            .use_color = req.log_color,
+            .out       = err
+        };
+        Coc_Log_Config *prev_log = coc_log_use(&log);
+        ServeModule *m = serve_module_get(s, path);
+        if (m == NULL) {
+            status = puncta_last_error()->status;
+        } else {
+            VM *vm = vm_new(m->code->module);
+            vm_set_io(vm, in, out);
+            vm_set_limits(vm, serve_limit(req.max_instructions, s->opts->max_instructions),
+                          (int)serve_limit((uint64_t)req.timeout_ms, (uint64_t)s->timeout_ms));
+            vm_set_cancel(vm, &w->cancel);
+            if (s->register_user_actions != NULL) s->register_user_actions(vm);
+            serve_watch(w, conn);
+            VmStepStatus step;
+            while ((step = vm_step(vm, UINT64_MAX)) == VM_STEP_WAIT_INPUT && feed[1] >= 0) {
+                fflush(out); // a prompt shows before the wait
+                serve_feed_input(w, fds[0], &feed[1]);
+            }
+            status = step == VM_STEP_FINISHED ? PUNCTA_OK : vm->error.status;
+            serve_watch(w, -1);
+            fflush(out);
+            vm_free(vm);
+            serve_module_release(s, m);
+        }
+        coc_log_use(prev_log);
+    }
+    close(fds[0]);
+    if (in != NULL) fclose(in);
+    else if (feed[0] >= 0) close(feed[0]);
+    if (feed[1] >= 0) close(feed[1]);
+    if (out != NULL) fclose(out);
+    else close(fds[1]);
+    if (err != NULL) fclose(err);
+    else close(fds[2]);
+    serve_write_all(conn, &status, sizeof(status));
+}
+
+static inline void *serve_main(void *arg) {
+    ServeWorker *w = (ServeWorker *)arg;
+    Serve *s = w->s;
+    while (true) {
+        pthread_mutex_lock(&s->lock);
+        while (s->count == 0 && !s->stop) pthread_cond_wait(&s->ready, &s->lock);
+        if (s->count == 0) {
+            pthread_mutex_unlock(&s->lock);
+            return NULL;
+        }
+        int conn = s->queue[s->head];
+        s->head = (s->head + 1) % SERVE_QUEUE;
+        s->count--;
+        pthread_cond_signal(&s->room);
+        pthread_mutex_unlock(&s->lock);
+        serve_handle(w, conn);
+        close(conn);
+    }
+}
+
+// Serves requests on the socket at sock_path until SIGINT or SIGTERM.
+// The limits in opts apply to every request, on top of its own, with a
+// timeout of SERVE_TIMEOUT_MS when opts has none; jobs is the number of
+// threads (0: one per CPU). Requests still running at shutdown are
+// cancelled. Returns 0, or an errno value when the socket cannot be set up.
+static inline int run_serve(const char *sock_path, void (*register_user_actions)(VM *), const RunOptions *opts) {
+    RunOptions defaults = {0};
+    if (opts == NULL) opts = &defaults;
+    struct sockaddr_un addr;
+    int err = serve_address(sock_path, &addr);
+    if (err != 0) return err;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) return errno;
+    unlink(sock_path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        err = errno;
+        close(listener);
+        return err;
+    }
+    Serve s = {.opts = opts, .register_user_actions = register_user_actions,
+               .timeout_ms = opts->timeout_ms > 0 ? opts->timeout_ms : SERVE_TIMEOUT_MS};
+    if (pipe(s.wake) != 0) {
+        err = errno;
+        close(listener);
+        unlink(sock_path);
+        return err;
+    }
+    fcntl(s.wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(s.wake[1], F_SETFL, O_NONBLOCK);
+
+    // Only the accepting thread takes the signals, so that poll() is interrupted
+    struct sigaction sa = {.sa_handler = serve_on_signal};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t stop_signals, prev_mask;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &prev_mask);
+
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.ready, NULL);
+    pthread_cond_init(&s.room, NULL);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int worker_count = opts->jobs > 0 ? opts->jobs : (cpus > 0 ? (int)cpus : 1);
+    s.workers = (ServeWorker *)COC_CALLOC(worker_count, sizeof(ServeWorker));
+    // The listener, the self-pipe and one connection per worker
+    struct pollfd *pfds = (struct pollfd *)COC_CALLOC(worker_count + 2, sizeof(struct pollfd));
+    ServeWorker **watched = (ServeWorker **)COC_CALLOC(worker_count, sizeof(ServeWorker *));
+    COC_ASSERT(s.workers != NULL && pfds != NULL && watched != NULL);
+    int started = 0;
+    for (; started < worker_count; started++) {
+        ServeWorker *w = &s.workers[started];
+        w->s    = &s;
+        w->conn = -1;
+        atomic_init(&w->cancel, false);
+        if (pipe(w->wake) != 0) {
+            coc_log(COC_WARNING, "Cannot start serve thread: %s", strerror(errno));
+            break;
+        }
+        fcntl(w->wake[0], F_SETFL, O_NONBLOCK);
+        fcntl(w->wake[1], F_SETFL, O_NONBLOCK);
+        err = pthread_create(&w->thread, NULL, serve_main, w);
+        if (err != 0) {
+            coc_log(COC_WARNING, "Cannot start serve thread: %s", strerror(err));
+            close(w->wake[0]);
+            close(w->wake[1]);
+            break;
+        }
+    }
+    s.worker_count = started;
+    pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+    err = started > 0 ? 0 : EAGAIN;
+    if (started > 0) coc_log(COC_INFO, "Serving on %s with %d threads", sock_path, started);
+
+    while (started > 0 && !serve_interrupted) {
+        nfds_t n = 0;
+        pfds[n++] = (struct pollfd){.fd = listener, .events = POLLIN};
+        pfds[n++] = (struct pollfd){.fd = s.wake[0], .events = POLLIN};
+        pthread_mutex_lock(&s.lock);
+        for (int i = 0; i < started; i++) {
+            ServeWorker *w = &s.workers[i];
+            if (w->conn < 0 || atomic_load(&w->cancel)) continue;
+            watched[n - 2] = w;
+            pfds[n++] = (struct pollfd){.fd = w->conn, .events = 0};
+        }
+        pthread_mutex_unlock(&s.lock);
+        if (poll(pfds, n, -1) < 0) {
+            if (errno != EINTR) coc_log(COC_WARNING, "poll() failed: %s", strerror(errno));
+            continue;
+        }
+        if (pfds[1].revents & POLLIN) {
+            char buf[64];
+            while (read(s.wake[0], buf, sizeof(buf)) > 0);
+        }
+        // POLLHUP only once the client closed its end: it is gone, and so
+        // is whoever would read the output
+        pthread_mutex_lock(&s.lock);
+        for (nfds_t i = 2; i < n; i++) {
+            ServeWorker *w = watched[i - 2];
+            if ((pfds[i].revents & (POLLHUP | POLLERR)) != 0 && w->conn == pfds[i].fd) {
+                serve_cancel(w);
+                coc_log(COC_INFO, "Serve: client hung up, cancelling its request");
+            }
+        }
+        pthread_mutex_unlock(&s.lock);
+        if ((pfds[0].revents & POLLIN) == 0) continue;
+        int conn = accept(listener, NULL, NULL);
+        if (conn < 0) {
+            if (errno != EINTR) coc_log(COC_WARNING, "accept() failed: %s", strerror(errno));
+            continue;
+        }
+        pthread_mutex_lock(&s.lock);
+        while (s.count == SERVE_QUEUE) pthread_cond_wait(&s.room, &s.lock);
+        s.queue[(s.head + s.count) % SERVE_QUEUE] = conn;
+        s.count++;
+        pthread_cond_signal(&s.ready);
+        pthread_mutex_unlock(&s.lock);
+    }
+
+    coc_log(COC_INFO, "Serve: shutting down");
+    close(listener);
+    unlink(sock_path);
+    pthread_mutex_lock(&s.lock);
+    s.stop = true;
+    for (int i = 0; i < started; i++) serve_cancel(&s.workers[i]);
+    pthread_cond_broadcast(&s.ready);
+    pthread_mutex_unlock(&s.lock);
+    for (int i = 0; i < started; i++) pthread_join(s.workers[i].thread, NULL);
+    for (size_t i = 0; i < s.modules.capacity; i++) {
+        if (s.modules.items[i].is_used) serve_module_release(&s, s.modules.items[i].value);
+    }
+    coc_ht_free(&s.modules);
+    pthread_cond_destroy(&s.room);
+    pthread_cond_destroy(&s.ready);
+    pthread_mutex_destroy(&s.lock);
+    for (int i = 0; i < started; i++) {
+        close(s.workers[i].wake[0]);
+        close(s.workers[i].wake[1]);
+    }
+    close(s.wake[0]);
+    close(s.wake[1]);
+    COC_FREE(watched);
+    COC_FREE(pfds);
+    COC_FREE(s.workers);
+    return err;
+}
+
+// Client side of serve mode: runs filename on the server at sock_path with
+// the stdin, stdout and stderr of this process. Returns the status of the
+// run, or -1 when the server cannot be reached (nothing has run then).
+static inline int run_client(const char *sock_path, const char *filename, const RunOptions *opts) {
+    RunOptions defaults = {0};
+    if (opts == NULL) opts = &defaults;
+    struct sockaddr_un addr;
+    if (serve_address(sock_path, &addr) != 0) return -1;
+    char resolved[PATH_MAX];
+    const char *path = realpath(filename, resolved) != NULL ? resolved : filename;
+    size_t path_len = strlen(path);
+    if (path_len == 0 || path_len >= SERVE_PATH_MAX) return -1;
+    int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conn < 0) return -1;
+    if (connect(conn, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        coc_log(COC_DEBUG, "Cannot connect to %s: %s", sock_path, strerror(errno));
+        close(conn);
+        return -1;
+    }
+    const Coc_Log_Config *log = coc_log_current();
+    ServeRequest req = {
+        .magic            = SERVE_MAGIC,
+        .puncta_major     = PUNCTA_VERSION_MAJOR,
+        .puncta_minor     = PUNCTA_VERSION_MINOR,
+        .puncta_patch     = PUNCTA_VERSION_PATCH,
+        .path_len         = (uint16_t)path_len,
+        .timeout_ms       = opts->timeout_ms,
+        .max_instructions = opts->max_instructions,
+        .log_level        = log->min_level,
+        .log_date         = log->use_date,
+        .log_time         = log->use_time,
+        .log_ms           = log->use_ms,
+        .log_color        = log->use_color
+    };
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    union {
+        char           buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {.iov_base = &req, .iov_len = sizeof(req)};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1,
+                         .msg_control = control.buf, .msg_controllen = sizeof(control.buf)};
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    fflush(stdout);
+    ssize_t n;
+    do n = sendmsg(conn, &msg, 0); while (n < 0 && errno == EINTR);
+    int32_t status = -1;
+    if (n != (ssize_t)sizeof(req) || !serve_write_all(conn, path, path_len)) {
+        coc_log(COC_DEBUG, "Cannot send the request to %s", sock_path);
+    } else if (!serve_read_all(conn, &status, sizeof(status))) {
+        coc_log(COC_ERROR, "Lost the connection to %s", sock_path);
+        status = PUNCTA_ERR_IO;
+    }
+    close(conn);
+    return status;
+}
+
+#endif // _WIN32
+
+#endif // PUNCTA_H_
+
+/*
+Recent Revision History:
+
+1.17.0 (2026-10-18)
+
+Added:
+- OP_CALL and OP_RET: L@; calls L and @; returns, on a return stack of up to CALL_STACK_MAX calls per VM
+
+1.16.0 (2026-10-18)
+
+Added:
+- PunctaStream, stream_open(), stream_run(), stream_free(), run_stream_opts(): run a program while it is read
+- module_freeze_from(), vm_jeq_cond()
+
+1.15.0 (2026-10-18)
+
+Added:
+- parse_parallel(), parse_split(), compile_jobs: large sources are parsed in slices on several threads
+- LabelList; slices are merged into the program of the first one and freed as they go
+- parse_parallel() falls back to a single pass on Windows; puncta.h refuses COC_NO_THREADS
+
+1.14.0 (2026-10-18)
+
+Added:
+- run_serve(), run_client(): compile server on a Unix domain socket, ServeRequest, ServeModule
+- ServeWorker, SERVE_TIMEOUT_MS: requests are cancelled when their client hangs up
+  or the server shuts down, and time out after SERVE_TIMEOUT_MS by default
+- serve_feed_input(): the worker passes the client's stdin on to the VM through a pipe,
+  so that a cancel also stops a request waiting for input
+- vm_set_cancel(), VM.cancel: stop a run from another thread at its next limit check
+  or at the end of its input
+- ServeModule.digest: modules are reused on a matching 128-bit source digest
+- stat_ctime_ns() for the module cache
+
+1.13.0 (2026-10-18)
+
+Added:
+- vm_set_limits(), PUNCTA_ERR_LIMIT; max_instructions and timeout_ms in RunOptions
+
+1.12.0 (2026-10-18)
+
+Added:
+- vm_step(), VmStepStatus, run_steps(): resumable execution with an instruction budget
+- PUNCTA_WAIT_INPUT, puncta_wait_input(); input!, getc! and gets! wait on non-blocking input
+
+1.11.0 (2026-10-18)
+
+Added:
+- VmSnapshot, vm_snapshot(), vm_clone(), vm_snapshot_free(): start VMs from a warmed state
+- vm_stream_tell(), vm_stream_seek(): clones resume the input where the snapshot left it
+- vm_hand_over_counters(): run() hands its counts to the VM before each action,
+  so a snapshot taken there carries the exact instruction count
+
+1.10.0 (2026-10-18)
+
+Added:
+- Module, module_free(), module_freeze(), vm_new(): VMs run a shared read-only module
+
+Changed:
+- VM no longer owns code: vm_init(Parser *) -> module_init(), vm_check_labels() -> module_check_labels()
+- builtin actions are linked into Instruction.target at load, OP_ACT skips the name lookup
+- run() and run_profiled() keep the program in locals
+
+Removed:
+- vm_share(), vm_spawn(): a Module is shared instead
+
+1.9.0 (2026-10-18)
+
+Added:
+- run_batch_opts(), work-stealing batch runner; jobs in RunOptions
+- vm_share(), vm_spawn(): VMs running the code of another VM
+- vm_set_io(), VM.in, VM.out; load_file()
+
+Changed:
+- I/O actions read vm->in and write vm->out instead of stdin and stdout
+
+1.8.0 (2026-10-18)
+
+Added:
+- PunctaStatus, PunctaError, PunctaTrap, puncta_raise(), puncta_last_error(), puncta_status_name()
+- vm_run(), vm_set_log(); VM.log, VM.error
+
+Changed:
+- lexer, parser, VM, actions and eval! raise errors instead of calling exit()
+- compile_source(), compile_file() and compile_file_cached() return NULL on a compile error
+- run_vm_opts() returns the status of the run, run_file_opts() returns NULL when it failed
+- perf_counters is thread-local, bytecode cache counters are atomic
+- the lexer works on SSO sources (short strings passed to compile_source())
+
+1.7.0 (2026-10-18)
+
+Added:
+- Metrics, metrics_start(), metrics_stop(), metrics_read(), metrics_action_calls()
+- metrics_write_prometheus(), metrics_write_file(), exporter thread woken by SIGUSR1
+- VM.jumps; metrics and metrics_interval_ms in RunOptions
+
+Changed:
+- run() and run_profiled() hand instruction counts to the VM every METRICS_BATCH steps
+- vm_jeq() returns whether the jump was taken
+
+1.6.0 (2026-10-18)
+
+Added:
+- stats_write_json(), stats_json in RunOptions
+
+1.5.0 (2026-10-18)
+
+Added:
+- stats_report(), stats in RunOptions, lexer time and PHASE_REGISTER for it
+- PerfCounters.load_link_ns, stats_load_link_ns(), stats_phase_ns(): label
+  checking inside a bytecode load is reported as link
+
+1.4.0 (2026-10-18)
+
+Added:
+- PerfCounters, Phase, perf_open(), perf_phase_begin(), perf_phase_end(), perf_report()
+- VM.steps, instructions executed by run(); perf_counters in RunOptions
+- run_vm_opts(), the run half of run_file_opts()
+
+1.3.0 (2026-10-18)
+
+Added:
+- Sampler, sample_start(), sample_stop(), sample_write_folded(), SIGPROF sampling profiler
+- sample_hz and sample_output in RunOptions
+
+1.2.0 (2026-10-18)
+
+Added:
+- Profile, run_profiled(), profile_start(), profile_stop(), profile_report(), profile_write_json()
+- profile and profile_json in RunOptions
+- ProfileActionEntry, ProfileActionIndex: actions are indexed by their resolved
+  function with coc_iht_*
+
+1.1.3 (2026-10-18)
+
+Fixed:
+- wrong format specifier in the string literal length error
+
+1.1.2 (2026-10-18)
+
+Changed:
+- LabelHashTable, VarHashTable, ActHashTable follow the coc.h 1.6.0 hash table layout
+- vm_assign() updates an existing variable in place instead of copying its name
+
+1.1.1 (2026-10-18)
+
+Added:
+- BuiltinAction, builtin_actions[] static perfect hash, builtin_action_find()
+
+Changed:
+- Action *vm_get_action() -> Action vm_get_action(), builtins are checked first
+- register_act() refuses to override a builtin action
+
+Removed:
+- register_builtin_actions(), VM creation no longer allocates for builtins
+
+1.1.0 (2026-10-18)
+
+Added:
+- target (in Instruction struct), jumps resolved by vm_check_labels()
+- compile_source(), compile_file()
+- bytecode files (.punc): bytecode_save(), bytecode_load(), compile_file_cached()
+- stat_mtime_ns(), src_mtime_ns and src_ctime_ns in BytecodeHeader: the stat check
+  is only trusted for sources changed before the cache was written, else the digest decides
+- SourceDigest, source_digest(): 128-bit content digest, src_digest_lo/hi in BytecodeHeader
+- RunOptions, run_file_opts()
+
+Changed:
+- run_file() accepts .punc files
+
+1.0.9 (2026-10-18)
+
+Added:
+- arena (in VM struct), compile pipeline allocates from a Coc_Arena
+
+Changed:
+- vm_free() releases compile-time data in one call
+- runtime error messages no longer modify instruction strings
 
 1.0.8 (2026-01-15)
 
@@ -1,10 +1,10 @@
-// puncta_eval.h - version 1.0.3 (2026-01-16)
+// puncta_eval.h - version 1.1.0 (2026-10-18)
 #ifndef PUNCTA_EVAL_H_
 #define PUNCTA_EVAL_H_
 
 #define PUNCTA_EVAL_VERSION_MAJOR 1
-#define PUNCTA_EVAL_VERSION_MINOR 0
-#define PUNCTA_EVAL_VERSION_PATCH 3
+#define PUNCTA_EVAL_VERSION_MINOR 1
+#define PUNCTA_EVAL_VERSION_PATCH 0
 
 #include <math.h>
 #include "coc.h"
@@ -12,6 +12,13 @@
 #define EVAL_EXPR_MAX 32
 #define EVAL_NODE_MAX (2 * EVAL_EXPR_MAX + 8)
 #define EVAL_TOKEN_MAX EVAL_EXPR_MAX + 8
+#define EVAL_ERROR_LEN 192
+
+// Receives the complete message of an evaluation error and must not return.
+// Define it before including this file to unwind instead of exiting.
+#ifndef EVAL_FAIL
+   #define EVAL_FAIL(msg) do { coc_log(COC_ERROR, "%s", msg); exit(1); } while (0)
+#endif // EVAL_FAIL
 
 typedef enum Eval_TokenKind {
     eval_tok_eof = -1,
@@ -40,8 +47,9 @@ typedef struct Eval_Token {
 } Eval_Token;
 
 static inline void eval_error(const char *msg, const char *expr, int pos, const char *ctx) {
-    coc_log(COC_ERROR, "%sEval error at pos %d in \"%s\": %s", ctx, pos, expr, msg);
-    exit(1);
+    char buf[EVAL_ERROR_LEN];
+    snprintf(buf, sizeof(buf), "%sEval error at pos %d in \"%s\": %s", ctx, pos, expr, msg);
+    EVAL_FAIL(buf);
 }
 
 static inline void eval_skip_whitespace(const char *s, int *pos) {
@@ -70,10 +78,9 @@ static inline Eval_Token eval_next_token(const char *s, int *pos, const char *ct
     }
     (*pos)++;
     if (strchr("+-*/%><#=!&|?:^()", c) == NULL) {
-        coc_log(COC_ERROR,
-                "%sEval error at pos %d in \"%s\": unexpected character %c",
-                ctx, *pos, s, c);
-        exit(1);
+        char msg[32];
+        snprintf(msg, sizeof(msg), "unexpected character %c", c);
+        eval_error(msg, s, *pos, ctx);
     }
     return (Eval_Token){.kind = (Eval_TokenKind)c};
 }
@@ -360,10 +367,9 @@ static inline double eval_node(const Eval_Node *n, const double vars[52], const
                 if (r == 0.5) return sqrt(l);
                 double res = pow(l, r);
                 if (!isfinite(res)) {
-                    coc_log(COC_ERROR,
-                            "%sEval error at pos %d in \"%s\": %g^%g overflow",
-                            ctx, n->pos, expr, l, r);
-                    exit(1);
+                    char msg[64];
+                    snprintf(msg, sizeof(msg), "%g^%g overflow", l, r);
+                    eval_error(msg, expr, n->pos, ctx);
                 }
                 return res;
             }
@@ -415,6 +421,11 @@ static inline double eval_run(const char *expr, const double vars[52], const cha
 /*
 Recent Revision History:
 
+1.1.0 (2026-10-18)
+
+Added:
+- EVAL_FAIL(msg) hook, called instead of exit() so that an embedder can unwind
+
 1.0.3 (2026-01-16)
 
 Added: